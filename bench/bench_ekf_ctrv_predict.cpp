@@ -0,0 +1,88 @@
+// EKF_CTRV::Predict with the fused transition kernel against the separate
+// StateTransition / ProcessQMatrix / ProcessJAMatrix steps: agreement over a
+// lidar/radar run and per-call latency for turning and straight targets.
+// Run from the build directory so that EKF_CTRV finds ../config.txt.
+
+#include "bench_util.h"
+#include "ekf_ctrv.h"
+
+namespace {
+
+const double kFrame = 0.05;
+
+/**
+ * Target on a circle of radius 20 m around (10, 5), alternating lidar and radar
+ */
+MeasurementPackage Measurement(int step) {
+    double t = step * kFrame;
+    double px = 10 + 20 * cos(0.2 * t);
+    double py = 5 + 20 * sin(0.2 * t);
+    MeasurementPackage m;
+    m.timestamp_ = t;
+    if (step % 2 == 0) {
+        m.sensor_type_ = MeasurementPackage::LASER;
+        m.raw_measurements_ = Eigen::VectorXd(2);
+        m.raw_measurements_ << px, py;
+    } else {
+        double vx = -4 * sin(0.2 * t);
+        double vy = 4 * cos(0.2 * t);
+        double rho = sqrt(px * px + py * py);
+        m.sensor_type_ = MeasurementPackage::RADAR;
+        m.raw_measurements_ = Eigen::VectorXd(3);
+        m.raw_measurements_ << rho, atan2(py, px), (px * vx + py * vy) / rho;
+    }
+    return m;
+}
+
+void CheckAgreement() {
+    EKF_CTRV fused, separate;
+    separate.setFusedPredict(false);
+    for (int step = 0; step < 2000; ++step) {
+        MeasurementPackage m = Measurement(step);
+        fused.ProcessMeasurement(m);
+        separate.ProcessMeasurement(m);
+    }
+    Eigen::VectorXd x_fused(5), x_separate(5);
+    Eigen::MatrixXd P_fused, P_separate;
+    fused.getState(x_fused);
+    separate.getState(x_separate);
+    fused.getCovariance(P_fused);
+    separate.getCovariance(P_separate);
+    std::cout << "agreement after 2000 frames: max |dx| " << std::scientific << std::setprecision(2)
+              << (x_fused - x_separate).cwiseAbs().maxCoeff() << ", max |dP| "
+              << (P_fused - P_separate).cwiseAbs().maxCoeff() << std::fixed << std::endl;
+}
+
+double TimePredict(EKF_CTRV &filter, long iterations) {
+    BenchTimer timer;
+    for (long i = 0; i < iterations; ++i)
+        filter.Predict(kFrame);
+    double seconds = timer.Seconds();
+    Eigen::VectorXd x(5);
+    filter.getState(x);
+    BenchKeep(x);
+    return seconds;
+}
+
+void Run(const char *label, int warmup_frames, long iterations) {
+    EKF_CTRV fused;
+    for (int step = 0; step < warmup_frames; ++step)
+        fused.ProcessMeasurement(Measurement(step));
+    EKF_CTRV separate = fused;
+    separate.setFusedPredict(false);
+
+    std::cout << label << std::endl;
+    BenchReport("  separate steps", iterations, TimePredict(separate, iterations));
+    BenchReport("  fused", iterations, TimePredict(fused, iterations));
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 2000000);
+    CheckAgreement();
+    // one lidar frame only: the yaw rate is still at its initial ~0, straight branch
+    Run("straight (|omega| <= 1e-4)", 1, iterations);
+    Run("turning", 200, iterations);
+    return 0;
+}
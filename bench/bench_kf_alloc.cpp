@@ -0,0 +1,174 @@
+// Counts heap allocations made by the steady-state predict/update loop.
+// Every operator new in this process is counted; after a warm-up pass the
+// filters must run their hot path without a single allocation. The program
+// exits with a failure status when any allocation is seen, so it can guard
+// against regressions.
+
+#include "bench_util.h"
+#include "kf.h"
+#include "kf_fixed.h"
+#include "kf_Fusion.h"
+#include "ekf.h"
+#include "ukf.h"
+#include <new>
+#include <vector>
+
+namespace {
+long g_allocations = 0;
+}
+
+void *operator new(std::size_t size) {
+    ++g_allocations;
+    void *p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+namespace {
+
+std::vector<MeasurementPackage> MakePackages(int n, bool polar_radar) {
+    std::vector<MeasurementPackage> packages(n);
+    for (int i = 0; i < n; ++i) {
+        double t = 0.05 * i;
+        double px = 5.0 * t + 1.0, py = 0.6 + 0.1 * cos(5.0 * t);
+        MeasurementPackage &m = packages[i];
+        m.timestamp_ = 1477010443000000.0 + 50000.0 * i;
+        if (i % 2 == 0) {
+            m.sensor_type_ = MeasurementPackage::LASER;
+            m.raw_measurements_ = Eigen::VectorXd(2);
+            m.raw_measurements_ << px, py;
+        } else if (polar_radar) {
+            m.sensor_type_ = MeasurementPackage::RADAR;
+            m.raw_measurements_ = Eigen::VectorXd(3);
+            m.raw_measurements_ << sqrt(px * px + py * py), atan2(py, px), 5.0 * px / sqrt(px * px + py * py);
+        } else {
+            m.sensor_type_ = MeasurementPackage::RADAR;
+            m.raw_measurements_ = Eigen::VectorXd(4);
+            m.raw_measurements_ << px, py, 5.0, 0.0;
+        }
+    }
+    return packages;
+}
+
+/**
+ * Runs fn once to warm up, then iterations more times, and returns the
+ * number of allocations made after the warm-up.
+ */
+template <typename Fn>
+long CountAllocations(const char *label, long iterations, Fn fn) {
+    fn(0);
+    long before = g_allocations;
+    BenchTimer timer;
+    for (long i = 1; i <= iterations; ++i)
+        fn(i);
+    double seconds = timer.Seconds();
+    long allocations = g_allocations - before;
+    BenchReport(label, iterations, seconds);
+    std::cout << "    allocations after warm-up: " << allocations << std::endl;
+    return allocations;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 200000);
+    const double dt = 0.05;
+
+    Eigen::Matrix4d F = Eigen::Matrix4d::Identity();
+    F(0, 2) = dt;
+    F(1, 3) = dt;
+    Eigen::Matrix4d Q = Eigen::Matrix4d::Identity() * 0.01;
+    Eigen::Matrix<double, 2, 4> H_laser;
+    H_laser << 1, 0, 0, 0,
+               0, 1, 0, 0;
+    Eigen::Matrix2d R_laser = Eigen::Matrix2d::Identity() * 0.0225;
+    Eigen::Vector2d z(1.0, 0.5);
+
+    long total = 0;
+
+    KF dyn;
+    Eigen::VectorXd x0 = Eigen::VectorXd::Zero(4);
+    Eigen::MatrixXd P0 = Eigen::MatrixXd::Identity(4, 4);
+    Eigen::MatrixXd F_dyn = F, Q_dyn = Q, H_dyn = H_laser, R_dyn = R_laser;
+    dyn.Init(x0, P0, F_dyn, H_dyn, R_dyn, Q_dyn);
+    Eigen::VectorXd z_dyn = z;
+    total += CountAllocations("KF (workspace) lidar", iterations, [&](long) {
+        dyn.Predict();
+        dyn.Update(z_dyn);
+    });
+
+    KF dyn_radar;
+    Eigen::MatrixXd H_radar = Eigen::MatrixXd::Identity(4, 4);
+    Eigen::MatrixXd R_radar = Eigen::MatrixXd::Identity(4, 4) * 0.09;
+    dyn_radar.Init(x0, P0, F_dyn, H_radar, R_radar, Q_dyn);
+    Eigen::VectorXd z_radar = Eigen::Vector4d(1.0, 0.5, 5.0, 0.0);
+    total += CountAllocations("KF (workspace) cartesian radar", iterations, [&](long) {
+        dyn_radar.Predict();
+        dyn_radar.Update(z_radar);
+    });
+
+    KF_FIXED<4> fixed;
+    fixed.F_ = F;
+    fixed.Q_ = Q;
+    total += CountAllocations("KF_FIXED<4> lidar", iterations, [&](long) {
+        fixed.Predict();
+        fixed.Update(z, H_laser, R_laser);
+    });
+
+    std::vector<MeasurementPackage> cartesian = MakePackages(1024, false);
+    KF_FUSION fusion;
+    total += CountAllocations("KF_FUSION::ProcessMeasurement", iterations, [&](long i) {
+        fusion.ProcessMeasurement(cartesian[i & 1023]);
+    });
+
+    std::vector<MeasurementPackage> polar = MakePackages(1024, true);
+    EKF ekf;
+    total += CountAllocations("EKF::ProcessMeasurement", iterations, [&](long i) {
+        ekf.ProcessMeasurement(polar[i & 1023]);
+    });
+
+    // the UKF state does not survive the stream jumping back in time, so
+    // its timestamps keep counting up as the packages are reused
+    UKF ukf;
+    total += CountAllocations("UKF::ProcessMeasurement", iterations, [&](long i) {
+        MeasurementPackage &m = polar[i & 1023];
+        m.timestamp_ = 1477010443000000LL + 50000LL * i;
+        ukf.ProcessMeasurement(m);
+    });
+
+    UKF sqrt_ukf;
+    sqrt_ukf.setSquareRoot(true);
+    total += CountAllocations("UKF (square root)", iterations, [&](long i) {
+        MeasurementPackage &m = polar[i & 1023];
+        m.timestamp_ = 1477010443000000LL + 50000LL * i;
+        sqrt_ukf.ProcessMeasurement(m);
+    });
+
+    // a log read through views: the filters take the values where they lie
+    MeasurementLog log;
+    for (size_t i = 0; i < polar.size(); ++i)
+        log.Append(polar[i].timestamp_, polar[i].sensor_type_, polar[i].raw_measurements_.data(),
+                   int(polar[i].raw_measurements_.size()));
+    UKF view_ukf;
+    total += CountAllocations("UKF from a MeasurementLog", iterations, [&](long i) {
+        const MeasurementView m = log[i & 1023];
+        view_ukf.ProcessMeasurement(MeasurementView(1477010443000000LL + 50000LL * i, m.sensor_type_,
+                                                    m.raw_measurements_.data(), int(m.raw_measurements_.size())));
+    });
+    EKF view_ekf;
+    total += CountAllocations("EKF from a MeasurementLog", iterations, [&](long i) {
+        view_ekf.ProcessMeasurement(log[i & 1023]);
+    });
+
+    if (total != 0) {
+        std::cerr << "FAILED: " << total << " heap allocations on the predict/update hot path" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "OK: hot path is allocation-free" << std::endl;
+    return 0;
+}
@@ -0,0 +1,251 @@
+// Hand-written Jacobians against kf_autodiff::Jacobian on the models in
+// kf_models.h and the CTRV transition below:
+//   CTRV transition  EKF_CTRV::ProcessJAMatrix, and the float version it
+//                    replaced
+//   CTRV radar       EKF_CTRV::ProcessHJMatrix as it was
+//   CV radar         the hand-written kf_radar::MeasurementCV kernel
+// Each is timed over the same states, a quarter of them driving straight
+// (|yaw rate| < 1e-4); each timing is the best of five runs. The largest
+// difference from the automatic-differentiation result is reported,
+// relative to the largest entry of the Jacobian.
+// The first argument sets the number of evaluations (default 10000000).
+
+#include "bench_util.h"
+#include "kf_autodiff.h"
+#include "kf_models.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+typedef Eigen::Matrix<double, 5, 1> Vector5d;
+typedef Eigen::Matrix<double, 5, 5> Matrix5d;
+typedef Eigen::Matrix<double, 3, 5> Matrix35d;
+typedef Eigen::Matrix<double, 3, 4> Matrix34d;
+
+/**
+ * The CTRV transition over dt for kf_autodiff, the straight-line limit
+ * below a yaw rate of 1e-4 (EKF_CTRV::StateTransition, without the yaw
+ * wrap and the pinned yaw rate, which do not change the Jacobian)
+ */
+struct CTRVTransition {
+    explicit CTRVTransition(double dt) : dt(dt) {}
+
+    template <typename T>
+    void operator()(const T *x, T *y) const {
+        const T &v = x[2], &theta = x[3], &omega = x[4];
+        if (fabs(omega) > 0.0001) {
+            const T theta_p = theta + omega * dt;
+            const T v_omega = v / omega;
+            y[0] = x[0] + v_omega * (sin(theta_p) - sin(theta));
+            y[1] = x[1] + v_omega * (cos(theta) - cos(theta_p));
+        } else {
+            y[0] = x[0] + v * cos(theta) * dt;
+            y[1] = x[1] + v * sin(theta) * dt;
+        }
+        y[2] = v;
+        y[3] = theta + omega * dt;
+        y[4] = omega;
+    }
+
+    double dt;
+};
+
+// EKF_CTRV::ProcessJAMatrix with Real = double;
+// Real = float is the version before it, which lost the yaw-rate column
+// to cancellation at small yaw rates
+template <typename Real>
+void HandTransitionJacobian(const Vector5d &x_, double delta_t, Matrix5d &JA_) {
+    Real v = x_[2];
+    Real theta = x_[3];
+    Real omiga = x_[4];
+    Real q13, q14, q15, q23, q24, q25;
+    if (fabs(omiga) > 0.0001) {
+        Real tmpTheta = omiga * delta_t + theta;
+        Real v_omiga = v / omiga;
+        Real _1_omiga = 1 / omiga;
+        Real delta_t_v_omiga = delta_t * v_omiga;
+        Real v_omiga2 = v / omiga / omiga;
+        q13 = _1_omiga * (-sin(theta) + sin(tmpTheta));
+        q14 = v_omiga * (-cos(theta) + cos(tmpTheta));
+        q15 = delta_t_v_omiga * cos(tmpTheta) - v_omiga2 * (-sin(theta) + sin(tmpTheta));
+        q23 = _1_omiga * (cos(theta) - cos(tmpTheta));
+        q24 = v_omiga * (-sin(theta) + sin(tmpTheta));
+        q25 = delta_t_v_omiga * sin(tmpTheta) - v_omiga2 * (cos(theta) - cos(tmpTheta));
+    } else {
+        q13 = delta_t * cos(theta);
+        q14 = -delta_t * v * sin(theta);
+        q15 = 0;
+        q23 = delta_t * sin(theta);
+        q24 = delta_t * v * cos(theta);
+        q25 = 0;
+    }
+    JA_ << 1, 0, q13, q14, q15,
+        0, 1, q23, q24, q25,
+        0, 0, 1, 0, 0,
+        0, 0, 0, 1, delta_t,
+        0, 0, 0, 0, 1;
+}
+
+// EKF_CTRV::ProcessHJMatrix before kf_autodiff
+void HandCTRVRadar(const Vector5d &x_, Eigen::Vector3d &hx, Matrix35d &HJ_) {
+    double x = x_[0];
+    double y = x_[1];
+    double v = x_[2];
+    double theta = x_[3];
+    double x2y2 = (x * x + y * y);
+    double sqrt_x2y2 = (sqrt(x2y2));
+    double sqrt23_x2y2 = pow(x2y2, 3.0 / 2.0);
+    double vxvy = v * x * cos(theta) + v * y * sin(theta);
+    HJ_ << x / sqrt_x2y2, y / sqrt_x2y2, 0, 0, 0,
+        -y / x2y2, x / x2y2, 0, 0, 0,
+        v * cos(theta) / sqrt_x2y2 - x * vxvy / sqrt23_x2y2,
+        v * sin(theta) / sqrt_x2y2 - y * vxvy / sqrt23_x2y2,
+        (x * cos(theta) + y * sin(theta)) / sqrt_x2y2,
+        (-x * v * sin(theta) + y * v * cos(theta)) / sqrt_x2y2, 0;
+    hx << sqrt_x2y2, atan2(y, x), (v * x * cos(theta) + v * y * sin(theta)) / sqrt_x2y2;
+}
+
+// kf_radar::MeasurementCV before kf_autodiff
+void HandCVRadar(const Eigen::Vector4d &x, Eigen::Vector3d &h, Matrix34d &H) {
+    const double px = x[0], py = x[1], vx = x[2], vy = x[3];
+    const double c1 = px * px + py * py;
+    const double rho = sqrt(c1);
+    const double inv_rho = 1 / rho;
+    const double inv_c1 = inv_rho * inv_rho;
+    const double cross_c3 = (vx * py - vy * px) * inv_c1 * inv_rho;
+    h << rho, atan2(py, px), (px * vx + py * vy) * inv_rho;
+    H << px * inv_rho, py * inv_rho, 0, 0,
+        -py * inv_c1, px * inv_c1, 0, 0,
+        py * cross_c3, -px * cross_c3, px * inv_rho, py * inv_rho;
+}
+
+template <typename Derived>
+double Relative(const Eigen::MatrixBase<Derived> &a, const Eigen::MatrixBase<Derived> &b) {
+    return (a - b).cwiseAbs().maxCoeff() / b.cwiseAbs().maxCoeff();
+}
+
+// best of five timings of body(0) .. body(n - 1)
+template <typename Body>
+double Best(long n, Body body) {
+    double best = 1e300;
+    for (int run = 0; run < 5; ++run) {
+        BenchTimer timer;
+        for (long i = 0; i < n; ++i)
+            body(i);
+        best = std::min(best, timer.Seconds());
+    }
+    return best;
+}
+
+void Row(const char *name, long n, double hand_seconds, double ad_seconds) {
+    std::cout << name << std::endl;
+    BenchReport("  hand-written", n, hand_seconds);
+    BenchReport("  kf_autodiff", n, ad_seconds);
+}
+
+void Difference(const char *what, double difference) {
+    std::cout << "  largest relative difference" << what << " " << std::scientific
+              << std::setprecision(2) << difference << std::fixed << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long n = BenchIterations(argc, argv, 10000000);
+    const double dt = 0.05;
+    std::vector<Vector5d, Eigen::aligned_allocator<Vector5d> > states(1024);
+    unsigned int seed = 3;
+    for (size_t i = 0; i < states.size(); ++i) {
+        double u[5];
+        for (int k = 0; k < 5; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            u[k] = (seed >> 8) * (1.0 / 16777216.0) - 0.5;
+        }
+        states[i] << 60 * u[0], 60 * u[1], 20 * u[2], 6 * u[3], i % 4 ? 2 * u[4] : 1e-5 * u[4];
+    }
+
+    double d_ja = 0, d_ja_float = 0, d_hj = 0, d_cv = 0;
+    for (size_t i = 0; i < states.size(); ++i) {
+        Vector5d fx;
+        Matrix5d JA, JA_float, JA_ad;
+        HandTransitionJacobian<double>(states[i], dt, JA);
+        HandTransitionJacobian<float>(states[i], dt, JA_float);
+        kf_autodiff::Jacobian(CTRVTransition(dt), states[i], fx, JA_ad);
+        d_ja = std::max(d_ja, Relative(JA, JA_ad));
+        d_ja_float = std::max(d_ja_float, Relative(JA_float, JA_ad));
+
+        Eigen::Vector3d h, h_ad;
+        Matrix35d HJ, HJ_ad;
+        HandCTRVRadar(states[i], h, HJ);
+        kf_autodiff::Jacobian(kf_models::CTRVRadar(), states[i], h_ad, HJ_ad);
+        d_hj = std::max(d_hj, std::max(Relative(HJ, HJ_ad), Relative(h, h_ad)));
+
+        const Eigen::Vector4d x = states[i].head<4>();
+        Matrix34d H, H_ad;
+        HandCVRadar(x, h, H);
+        kf_autodiff::Jacobian(kf_models::CVRadar(), x, h_ad, H_ad);
+        d_cv = std::max(d_cv, std::max(Relative(H, H_ad), Relative(h, h_ad)));
+    }
+
+    Matrix5d JA_sum = Matrix5d::Zero();
+    Matrix35d H_sum = Matrix35d::Zero();
+    Matrix34d Hcv_sum = Matrix34d::Zero();
+    Eigen::Vector3d h_sum = Eigen::Vector3d::Zero();
+
+    Row("CTRV transition Jacobian", n,
+        Best(n, [&](long i) {
+            Matrix5d JA;
+            HandTransitionJacobian<double>(states[i & 1023], dt, JA);
+            JA_sum += JA;
+        }),
+        Best(n, [&](long i) {
+            Vector5d fx;
+            Matrix5d JA;
+            kf_autodiff::Jacobian(CTRVTransition(dt), states[i & 1023], fx, JA);
+            JA_sum += JA;
+        }));
+    Difference("", d_ja);
+    Difference(" of the float version", d_ja_float);
+
+    Row("CTRV radar h(x) and Jacobian", n,
+        Best(n, [&](long i) {
+            Eigen::Vector3d h;
+            Matrix35d H;
+            HandCTRVRadar(states[i & 1023], h, H);
+            H_sum += H;
+            h_sum += h;
+        }),
+        Best(n, [&](long i) {
+            Eigen::Vector3d h;
+            Matrix35d H;
+            kf_autodiff::Jacobian(kf_models::CTRVRadar(), states[i & 1023], h, H);
+            H_sum += H;
+            h_sum += h;
+        }));
+    Difference("", d_hj);
+
+    Row("CV radar h(x) and Jacobian", n,
+        Best(n, [&](long i) {
+            Eigen::Vector3d h;
+            Matrix34d H;
+            HandCVRadar(states[i & 1023].head<4>(), h, H);
+            Hcv_sum += H;
+            h_sum += h;
+        }),
+        Best(n, [&](long i) {
+            Eigen::Vector3d h;
+            Matrix34d H;
+            const Eigen::Vector4d x = states[i & 1023].head<4>();
+            kf_autodiff::Jacobian(kf_models::CVRadar(), x, h, H);
+            Hcv_sum += H;
+            h_sum += h;
+        }));
+    Difference("", d_cv);
+
+    BenchKeep(JA_sum);
+    BenchKeep(H_sum);
+    BenchKeep(Hcv_sum);
+    BenchKeep(h_sum);
+    return 0;
+}
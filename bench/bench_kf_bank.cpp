@@ -0,0 +1,118 @@
+// KFBank against one KF_FUSION object per track: agreement on lidar tracks
+// and predict+update throughput from 1 to 100k tracks.
+// Run from the build directory so that KF_FUSION finds ../config.txt.
+
+#include "bench_util.h"
+#include "kf_bank.h"
+#include "kf_Fusion.h"
+#include <vector>
+
+namespace {
+
+const double kFrame = 0.05;
+
+double TruthX(int track, int step) { return 0.1 * track + 5.0 * kFrame * step; }
+double TruthY(int track, int step) { return 0.5 * track + sin(0.3 * step + track); }
+
+MeasurementPackage Lidar(int track, int step) {
+    MeasurementPackage m;
+    m.sensor_type_ = MeasurementPackage::LASER;
+    m.timestamp_ = 1477010443000000.0 + kFrame * 1e6 * step;
+    m.raw_measurements_ = Eigen::VectorXd(2);
+    m.raw_measurements_ << TruthX(track, step), TruthY(track, step);
+    return m;
+}
+
+/**
+ * Builds a bank initialised the way KF_FUSION initialises on a lidar hit
+ */
+void InitBank(KFBank &bank, int tracks, const Eigen::Matrix4d &P0) {
+    // lidar noise of KF_FUSION
+    const FilterConfig::CV &cv = FilterConfig::Default()->cv;
+    bank.setLidarNoise(cv.std_laspx, cv.std_laspy);
+    for (int t = 0; t < tracks; ++t)
+        bank.AddTrack(Eigen::Vector4d(TruthX(t, 0), TruthY(t, 0), 5, 0), P0);
+}
+
+void CheckAgainstFusion() {
+    const int tracks = 37, steps = 200;
+    std::vector<KF_FUSION> fusion(tracks);
+    Eigen::Matrix4d P0 = fusion[0].ekf_.P_;
+    KFBank bank;
+    InitBank(bank, tracks, P0);
+
+    std::vector<double> zx(tracks), zy(tracks);
+    for (int t = 0; t < tracks; ++t)
+        fusion[t].ProcessMeasurement(Lidar(t, 0));
+    for (int s = 1; s < steps; ++s) {
+        for (int t = 0; t < tracks; ++t) {
+            MeasurementPackage m = Lidar(t, s);
+            fusion[t].ProcessMeasurement(m);
+            zx[t] = m.raw_measurements_[0];
+            zy[t] = m.raw_measurements_[1];
+        }
+        bank.Predict(kFrame);
+        bank.UpdateLidar(&zx[0], &zy[0]);
+    }
+
+    double max_x = 0, max_P = 0;
+    Eigen::VectorXd x_bank(4), x_fusion(4);
+    for (int t = 0; t < tracks; ++t) {
+        bank.getState(t, x_bank);
+        fusion[t].getState(x_fusion);
+        max_x = std::max(max_x, (x_bank - x_fusion).cwiseAbs().maxCoeff());
+        max_P = std::max(max_P, (bank.getCovariance(t) - fusion[t].ekf_.P_).cwiseAbs().maxCoeff());
+    }
+    std::cout << "agreement with KF_FUSION after " << steps << " lidar frames: max |dx| "
+              << std::scientific << std::setprecision(2) << max_x << ", max |dP| " << max_P
+              << std::fixed << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long work = BenchIterations(argc, argv, 4000000);
+    std::cout << "KFBank lanes: " << KFBank::LaneName() << std::endl;
+    CheckAgainstFusion();
+
+    const int sizes[] = {1, 10, 100, 1000, 10000, 100000};
+    for (size_t n = 0; n < sizeof(sizes) / sizeof(sizes[0]); ++n) {
+        const int tracks = sizes[n];
+        const int steps = std::max(4L, work / tracks);
+        std::cout << tracks << " tracks, " << steps << " frames" << std::endl;
+
+        std::vector<KF_FUSION> fusion(tracks);
+        std::vector<MeasurementPackage> packages(tracks);
+        for (int t = 0; t < tracks; ++t) {
+            packages[t] = Lidar(t, 0);
+            fusion[t].ProcessMeasurement(packages[t]);
+        }
+        BenchTimer timer;
+        for (int s = 1; s <= steps; ++s) {
+            for (int t = 0; t < tracks; ++t) {
+                packages[t].timestamp_ += kFrame * 1e6;
+                packages[t].raw_measurements_[0] += 5.0 * kFrame;
+                fusion[t].ProcessMeasurement(packages[t]);
+            }
+        }
+        BenchReport("  KF_FUSION per track", (long)tracks * steps, timer.Seconds());
+
+        KFBank bank;
+        InitBank(bank, tracks, fusion[0].ekf_.P_);
+        std::vector<double> zx(tracks), zy(tracks);
+        for (int t = 0; t < tracks; ++t) {
+            zx[t] = packages[t].raw_measurements_[0];
+            zy[t] = packages[t].raw_measurements_[1];
+        }
+        timer.Reset();
+        for (int s = 1; s <= steps; ++s) {
+            // targets keep moving, so the velocities do not decay into denormals
+            for (int t = 0; t < tracks; ++t)
+                zx[t] += 5.0 * kFrame;
+            bank.Predict(kFrame);
+            bank.UpdateLidar(&zx[0], &zy[0]);
+        }
+        BenchReport("  KFBank", (long)tracks * steps, timer.Seconds());
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+// Predict + update throughput of the dynamic KF against KF_FIXED<4>.
+// Both filters run the KF_FUSION constant-velocity model on the same
+// synthetic lidar/radar stream; the final states are compared at the end.
+
+#include "bench_util.h"
+#include "kf.h"
+#include "kf_fixed.h"
+#include <math.h>
+#include <vector>
+
+namespace {
+
+struct Sample {
+    bool lidar;
+    Eigen::Vector4d z;
+};
+
+std::vector<Sample> MakeStream(int n) {
+    std::vector<Sample> stream(n);
+    for (int i = 0; i < n; ++i) {
+        double t = 0.05 * i;
+        stream[i].lidar = (i % 2) == 0;
+        stream[i].z << 5.0 * t + 0.1 * sin(7.0 * t), 0.6 + 0.1 * cos(5.0 * t), 5.0, 0.0;
+    }
+    return stream;
+}
+
+void FillQ(double dt, Eigen::Ref<Eigen::Matrix4d> Q) {
+    double dt2 = dt * dt, dt3 = dt2 * dt, dt4 = dt3 * dt, q = 9.0;
+    Q << dt4 / 4 * q, 0, dt3 / 2 * q, 0,
+         0, dt4 / 4 * q, 0, dt3 / 2 * q,
+         dt3 / 2 * q, 0, dt2 * q, 0,
+         0, dt3 / 2 * q, 0, dt2 * q;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 2000000);
+    const double dt = 0.05;
+    std::vector<Sample> stream = MakeStream(1024);
+
+    Eigen::Matrix<double, 2, 4> H_laser;
+    H_laser << 1, 0, 0, 0,
+               0, 1, 0, 0;
+    Eigen::Matrix4d H_radar = Eigen::Matrix4d::Identity();
+    Eigen::Matrix2d R_laser = Eigen::Vector2d(0.0225, 0.0225).asDiagonal();
+    Eigen::Matrix4d R_radar = Eigen::Vector4d(0.09, 0.09, 1.69, 1.69).asDiagonal();
+    Eigen::Matrix4d F = Eigen::Matrix4d::Identity();
+    F(0, 2) = dt;
+    F(1, 3) = dt;
+    Eigen::Matrix4d Q;
+    FillQ(dt, Q);
+
+    // dynamic KF, as used by KF_FUSION before the fixed-size port
+    KF dyn;
+    Eigen::VectorXd x0 = Eigen::VectorXd::Zero(4);
+    Eigen::MatrixXd P0 = Eigen::MatrixXd::Identity(4, 4);
+    Eigen::MatrixXd F_dyn = F, Q_dyn = Q, H_dyn = H_laser, R_dyn = R_laser;
+    dyn.Init(x0, P0, F_dyn, H_dyn, R_dyn, Q_dyn);
+    Eigen::MatrixXd H_laser_dyn = H_laser, H_radar_dyn = H_radar;
+    Eigen::MatrixXd R_laser_dyn = R_laser, R_radar_dyn = R_radar;
+
+    BenchTimer timer;
+    for (long i = 0; i < iterations; ++i) {
+        const Sample &s = stream[i & 1023];
+        dyn.Predict();
+        if (s.lidar) {
+            dyn.H_ = H_laser_dyn;
+            dyn.R_ = R_laser_dyn;
+            dyn.Update(s.z.head<2>());
+        } else {
+            dyn.H_ = H_radar_dyn;
+            dyn.R_ = R_radar_dyn;
+            dyn.Update(s.z);
+        }
+    }
+    double dyn_seconds = timer.Seconds();
+    BenchKeep(dyn.x_);
+
+    KF_FIXED<4> fixed;
+    fixed.F_ = F;
+    fixed.Q_ = Q;
+
+    timer.Reset();
+    for (long i = 0; i < iterations; ++i) {
+        const Sample &s = stream[i & 1023];
+        fixed.Predict();
+        if (s.lidar)
+            fixed.Update(s.z.head<2>(), H_laser, R_laser);
+        else
+            fixed.Update(s.z, H_radar, R_radar);
+    }
+    double fixed_seconds = timer.Seconds();
+    BenchKeep(fixed.x_);
+
+    std::cout << "predict+update, " << iterations << " iterations" << std::endl;
+    BenchReport("KF (MatrixXd)", iterations, dyn_seconds);
+    BenchReport("KF_FIXED<4>", iterations, fixed_seconds);
+    std::cout << "speedup: " << std::setprecision(2) << dyn_seconds / fixed_seconds << "x" << std::endl;
+    std::cout << "max |x_dyn - x_fixed|: " << std::scientific
+              << (dyn.x_ - fixed.x_).cwiseAbs().maxCoeff() << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+// Gain computation K = PHT * S^-1: explicit inverse against kf_update::SolveGain
+// for the lidar (2), radar (3) and cartesian radar (4) measurement sizes.
+
+#include "bench_util.h"
+#include "kf_update.h"
+#include <vector>
+
+namespace {
+
+template <int NX, int NZ>
+struct GainCase {
+    Eigen::Matrix<double, NZ, NZ> S;
+    Eigen::Matrix<double, NX, NZ> PHT;
+};
+
+template <int NX, int NZ>
+std::vector<GainCase<NX, NZ> > MakeCases(int n) {
+    std::vector<GainCase<NX, NZ> > cases(n);
+    for (int i = 0; i < n; ++i) {
+        Eigen::Matrix<double, NZ, NZ> A = Eigen::Matrix<double, NZ, NZ>::Random();
+        cases[i].S = A * A.transpose() + Eigen::Matrix<double, NZ, NZ>::Identity() * 0.1;
+        cases[i].PHT = Eigen::Matrix<double, NX, NZ>::Random();
+    }
+    return cases;
+}
+
+template <int NX, int NZ>
+void Run(long iterations) {
+    typedef Eigen::Matrix<double, NX, NZ> Gain;
+    std::vector<GainCase<NX, NZ> > cases = MakeCases<NX, NZ>(256);
+
+    Gain K, sum = Gain::Zero();
+    BenchTimer timer;
+    for (long i = 0; i < iterations; ++i) {
+        const GainCase<NX, NZ> &c = cases[i & 255];
+        K = c.PHT * c.S.inverse();
+        sum += K;
+    }
+    double inverse_seconds = timer.Seconds();
+    BenchKeep(sum);
+
+    sum.setZero();
+    timer.Reset();
+    for (long i = 0; i < iterations; ++i) {
+        const GainCase<NX, NZ> &c = cases[i & 255];
+        kf_update::SolveGain(c.S, c.PHT, K);
+        sum += K;
+    }
+    double solve_seconds = timer.Seconds();
+    BenchKeep(sum);
+
+    double max_error = 0;
+    for (size_t i = 0; i < cases.size(); ++i) {
+        Gain K_inv = cases[i].PHT * cases[i].S.inverse();
+        kf_update::SolveGain(cases[i].S, cases[i].PHT, K);
+        max_error = std::max(max_error, (K - K_inv).cwiseAbs().maxCoeff() / K_inv.cwiseAbs().maxCoeff());
+    }
+
+    std::cout << "NX=" << NX << " NZ=" << NZ << std::endl;
+    BenchReport("  PHT * S.inverse()", iterations, inverse_seconds);
+    BenchReport("  kf_update::SolveGain", iterations, solve_seconds);
+    std::cout << "  max relative difference: " << std::scientific << std::setprecision(2)
+              << max_error << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 5000000);
+    Run<4, 2>(iterations);
+    Run<4, 3>(iterations);
+    Run<4, 4>(iterations);
+    Run<5, 2>(iterations);
+    Run<5, 3>(iterations);
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Iterated EKF radar updates in EKF_CTRV, one update at a time. Each trial
+// starts a filter from a lidar fix at range d, so that the prior is that
+// fix with the configured initial covariance, draws the true state from
+// the prior and applies one radar measurement of it at the same
+// timestamp. At a few metres the prior position spread is a sizeable
+// fraction of the range and h is far from linear over it. For d = 1 to
+// 20 m this compares the plain EKF update, the plain update with the
+// bearing noise inflated threefold (the usual workaround), and iterated
+// updates of up to 2 to 10 linearisations, stopping once a step is below
+// 0.01 prior standard deviations.
+// Reports the cost per radar update, the RMSE of position and speed after
+// the update and the average number of linearisations.
+// The first argument sets the trials per range (default 20000).
+
+#include "bench_util.h"
+#include "ekf_ctrv.h"
+#include <memory>
+#include <vector>
+
+namespace {
+
+double Uniform(unsigned int &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0 / 16777216.0);
+}
+
+double Gaussian(unsigned int &seed) {
+    // sum of 12 uniforms, unit variance
+    double sum = 0;
+    for (int i = 0; i < 12; ++i)
+        sum += Uniform(seed);
+    return sum - 6;
+}
+
+struct Trial {
+    MeasurementPackage lidar;
+    MeasurementPackage radar;
+    // true px, py, v
+    Eigen::Vector3d truth;
+};
+
+/**
+ * The prior is what EKF_CTRV starts from on a lidar fix: the fix, speed 0,
+ * yaw -1.7, and the initial covariance of the config
+ */
+std::vector<Trial> MakeTrials(long trials, double range, const FilterConfig::CTRV &c) {
+    std::vector<Trial> out(trials);
+    unsigned int seed = 23;
+    for (long i = 0; i < trials; ++i) {
+        Trial &t = out[i];
+        const double bearing = 6.283185307179586 * Uniform(seed);
+        const double mx = range * cos(bearing), my = range * sin(bearing);
+        double px, py;
+        do {
+            px = mx + sqrt(c.px) * Gaussian(seed);
+            py = my + sqrt(c.py) * Gaussian(seed);
+        } while (px * px + py * py < 0.01);
+        const double v = sqrt(c.pv) * Gaussian(seed);
+        const double yaw = -1.7 + sqrt(c.ptheta) * Gaussian(seed);
+        const double rho = sqrt(px * px + py * py);
+        t.truth << px, py, v;
+        t.lidar.sensor_type_ = MeasurementPackage::LASER;
+        t.lidar.timestamp_ = 1;
+        t.lidar.raw_measurements_ = Eigen::VectorXd(2);
+        t.lidar.raw_measurements_ << mx, my;
+        t.radar.sensor_type_ = MeasurementPackage::RADAR;
+        t.radar.timestamp_ = 1;
+        t.radar.raw_measurements_ = Eigen::VectorXd(3);
+        t.radar.raw_measurements_ << rho + c.std_radrho * Gaussian(seed),
+            atan2(py, px) + c.std_radphi * Gaussian(seed),
+            v * (px * cos(yaw) + py * sin(yaw)) / rho + c.std_radrhodot * Gaussian(seed);
+    }
+    return out;
+}
+
+void Run(const char *label, const std::vector<Trial> &trials, std::shared_ptr<const FilterConfig> config,
+         int max_iterations) {
+    std::vector<std::unique_ptr<EKF_CTRV> > filters(trials.size());
+    for (size_t i = 0; i < trials.size(); ++i) {
+        filters[i].reset(new EKF_CTRV(config));
+        filters[i]->setIteratedUpdate(max_iterations, 0.01);
+        filters[i]->ProcessMeasurement(trials[i].lidar);
+    }
+
+    BenchTimer timer;
+    for (size_t i = 0; i < trials.size(); ++i)
+        filters[i]->ProcessMeasurement(trials[i].radar);
+    const double seconds = timer.Seconds();
+
+    Eigen::VectorXd state(5);
+    double position = 0, speed = 0;
+    long updates = 0, iterations = 0;
+    for (size_t i = 0; i < trials.size(); ++i) {
+        updates += filters[i]->radarUpdates();
+        iterations += filters[i]->radarIterations();
+        filters[i]->getState(state);
+        position += (state.head<2>() - trials[i].truth.head<2>()).squaredNorm();
+        speed += pow(state.segment<2>(2).norm() - fabs(trials[i].truth[2]), 2);
+    }
+    BenchReport(label, trials.size(), seconds);
+    std::cout << "    RMSE position " << std::setprecision(4) << sqrt(position / trials.size()) << " m, speed "
+              << sqrt(speed / trials.size()) << " m/tick, " << std::setprecision(2)
+              << double(iterations) / updates << " linearisations per update" << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long trials = BenchIterations(argc, argv, 20000);
+    std::shared_ptr<const FilterConfig> config = std::make_shared<FilterConfig>();
+    FilterConfig inflated_config = *config;
+    inflated_config.ctrv.std_radphi *= 3;
+    std::shared_ptr<const FilterConfig> inflated = std::make_shared<FilterConfig>(inflated_config);
+
+    const double ranges[] = {1, 2, 5, 20};
+    for (int r = 0; r < 4; ++r) {
+        const std::vector<Trial> data = MakeTrials(trials, ranges[r], config->ctrv);
+        std::cout << "range " << std::setprecision(0) << ranges[r] << " m" << std::endl;
+        Run("  EKF", data, config, 1);
+        Run("  EKF, bearing noise x3", data, inflated, 1);
+        Run("  IEKF, up to 2", data, config, 2);
+        Run("  IEKF, up to 3", data, config, 3);
+        Run("  IEKF, up to 5", data, config, 5);
+        Run("  IEKF, up to 10", data, config, 10);
+    }
+    return 0;
+}
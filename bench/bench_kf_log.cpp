@@ -0,0 +1,90 @@
+// A recording held as MeasurementPackages against a MeasurementLog read
+// through views. data/data_synthetic.txt (run from the build directory) is
+// parsed once and appended many times over, the way main.cpp builds its
+// list, then replayed through the UKF and EKF_CTRV. Reports the cost and
+// the heap allocations of building each form, and the cost per
+// measurement of the replays (best of three). Allocations are counted
+// with glibc only.
+// The first argument sets the number of copies (default 200).
+
+#include "bench_util.h"
+#include "ekf_ctrv.h"
+#include "ukf.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+long g_allocations = 0;
+}
+
+// Eigen takes its storage from malloc, not operator new, so the counter
+// sits on malloc itself (glibc; operator new goes through it as well)
+#ifdef __GLIBC__
+extern "C" void *__libc_malloc(std::size_t size);
+
+extern "C" void *malloc(std::size_t size) {
+    ++g_allocations;
+    return __libc_malloc(size);
+}
+#endif
+
+namespace {
+
+template <typename Build>
+void ReportBuild(const char *label, long measurements, Build build) {
+    const long before = g_allocations;
+    BenchTimer timer;
+    build();
+    const double seconds = timer.Seconds();
+    BenchReport(label, measurements, seconds);
+    std::cout << "    heap allocations " << g_allocations - before << std::endl;
+}
+
+template <typename Filter, typename Stream>
+double Replay(const Stream &stream) {
+    double best = 1e300;
+    for (int pass = 0; pass < 3; ++pass) {
+        Filter filter;
+        BenchTimer timer;
+        for (size_t i = 0; i < stream.size(); ++i)
+            filter.ProcessMeasurement(stream[i]);
+        best = std::min(best, timer.Seconds());
+    }
+    return best;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long copies = BenchIterations(argc, argv, 200);
+    std::vector<BenchFrame> recording;
+    if (!BenchLoadSynthetic(recording))
+        return 1;
+    const double span = BenchSpan(recording);
+    const long n = long(recording.size()) * copies;
+
+    std::vector<MeasurementPackage> packages;
+    ReportBuild("std::vector<MeasurementPackage>", n, [&]() {
+        for (long c = 0; c < copies; ++c)
+            for (size_t i = 0; i < recording.size(); ++i) {
+                MeasurementPackage meas = recording[i].meas;
+                meas.timestamp_ += c * span;
+                packages.push_back(meas);
+            }
+    });
+    MeasurementLog log;
+    ReportBuild("MeasurementLog", n, [&]() {
+        for (long c = 0; c < copies; ++c)
+            for (size_t i = 0; i < recording.size(); ++i) {
+                const MeasurementPackage &meas = recording[i].meas;
+                log.Append(meas.timestamp_ + c * span, meas.sensor_type_, meas.raw_measurements_.data(),
+                           int(meas.raw_measurements_.size()));
+            }
+    });
+
+    BenchReport("UKF, packages", n, Replay<UKF>(packages));
+    BenchReport("UKF, log", n, Replay<UKF>(log));
+    BenchReport("EKF_CTRV, packages", n, Replay<EKF_CTRV>(packages));
+    BenchReport("EKF_CTRV, log", n, Replay<EKF_CTRV>(log));
+    return 0;
+}
@@ -0,0 +1,95 @@
+// MeasurementMerger over 2 to 64 jittered sensor streams. Every source
+// produces a measurement each 50 ms at its own phase; each arrives 1 to
+// 5 ms after its timestamp, and one in a thousand is held up by 200 ms so
+// that it misses the 5 ms reorder window. The arrivals are pushed in
+// arrival order and popped as soon as they are released. Reports the merge
+// cost per measurement, the late and overflow drops and the most
+// measurements held,
+// and checks that the output is in timestamp order.
+// The first argument sets the measurements per run (default 1000000).
+
+#include "bench_util.h"
+#include "kf_merge.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Arrival {
+    double arrival_us;
+    int source;
+    MeasurementPackage meas;
+};
+
+bool EarlierArrival(const Arrival &a, const Arrival &b) {
+    return a.arrival_us < b.arrival_us;
+}
+
+std::vector<Arrival> MakeArrivals(int sources, long total) {
+    std::vector<Arrival> arrivals;
+    arrivals.reserve(total);
+    unsigned int seed = 7;
+    const long per_source = total / sources;
+    for (int s = 0; s < sources; ++s) {
+        const double phase_us = 50000.0 * s / sources;
+        for (long k = 0; k < per_source; ++k) {
+            Arrival a;
+            a.source = s;
+            a.meas.sensor_type_ = s % 2 ? MeasurementPackage::RADAR : MeasurementPackage::LASER;
+            a.meas.timestamp_ = 1477010443000000.0 + phase_us + 50000.0 * k;
+            a.meas.raw_measurements_ = Eigen::VectorXd::Constant(s % 2 ? 4 : 2, k);
+            seed = seed * 1664525u + 1013904223u;
+            a.arrival_us = a.meas.timestamp_ + 1000 + 4000 * ((seed >> 8) * (1.0 / 16777216.0));
+            seed = seed * 1664525u + 1013904223u;
+            if ((seed >> 16) % 1000 == 0)
+                a.arrival_us += 200000;
+            arrivals.push_back(a);
+        }
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(), EarlierArrival);
+    return arrivals;
+}
+
+void Run(int sources, long total) {
+    const std::vector<Arrival> arrivals = MakeArrivals(sources, total);
+    MeasurementMerger merger(sources, 5000);
+    MeasurementPackage out;
+    double last = 0, checksum = 0;
+    bool ordered = true;
+    int held = 0;
+
+    BenchTimer timer;
+    for (size_t i = 0; i < arrivals.size(); ++i) {
+        merger.Push(arrivals[i].source, arrivals[i].meas);
+        held = std::max(held, merger.size());
+        while (merger.Pop(out)) {
+            ordered = ordered && out.timestamp_ >= last;
+            last = out.timestamp_;
+            checksum += out.raw_measurements_[0];
+        }
+    }
+    merger.Finish();
+    while (merger.Pop(out)) {
+        ordered = ordered && out.timestamp_ >= last;
+        last = out.timestamp_;
+        checksum += out.raw_measurements_[0];
+    }
+    const double seconds = timer.Seconds();
+    BenchKeep(checksum);
+
+    std::string label = "  " + std::to_string(sources) + " sources";
+    BenchReport(label, arrivals.size(), seconds);
+    std::cout << "    released " << merger.released() << ", late drops " << merger.late_drops()
+              << ", overflow drops " << merger.overflow_drops() << ", forced " << merger.forced() << ", most held " << held << ", "
+              << (ordered ? "in order" : "OUT OF ORDER") << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long total = BenchIterations(argc, argv, 1000000);
+    std::cout << "Push + Pop per measurement, 5 ms reorder window" << std::endl;
+    for (int sources = 2; sources <= 64; sources *= 2)
+        Run(sources, total);
+    return 0;
+}
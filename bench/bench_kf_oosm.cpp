@@ -0,0 +1,157 @@
+// Out-of-sequence radar. A target on a 30 m circle is seen by a lidar and a
+// polar radar, each every 50 ms, half a period apart. The radar arrives
+// 30 to 130 ms late, behind one to three lidar frames, and is processed
+// in arrival order. EKF_CTRV does not hold this track through its radar
+// update, so for it the late sensor is a second lidar. For EKF, EKF_CTRV
+// and UKF this compares:
+//   in order      the same measurements sorted by timestamp (reference)
+//   late, no OOSM the current behaviour, predicting back over negative dt
+//   replay / retrodict / auto  OosmHistory with depth 16
+// Reports the cost per measurement, the position RMSE after each on-time
+// lidar frame and the OOSM counters.
+// The first argument sets the number of lidar frames (default 20000).
+
+#include "bench_util.h"
+#include "ekf.h"
+#include "ekf_ctrv.h"
+#include "ukf.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Arrival {
+    double arrival_us;
+    MeasurementPackage meas;
+    // truth (px, py) at the measurement
+    Eigen::Vector2d truth;
+    // the estimate is scored after measurements that arrive on time
+    bool on_time;
+};
+
+bool EarlierArrival(const Arrival &a, const Arrival &b) {
+    return a.arrival_us < b.arrival_us;
+}
+
+bool EarlierTimestamp(const Arrival &a, const Arrival &b) {
+    return a.meas.timestamp_ < b.meas.timestamp_;
+}
+
+double Uniform(unsigned int &seed) {
+    seed = seed * 1664525u + 1013904223u;
+    return (seed >> 8) * (1.0 / 16777216.0);
+}
+
+double Gaussian(unsigned int &seed) {
+    // sum of 12 uniforms, unit variance
+    double sum = 0;
+    for (int i = 0; i < 12; ++i)
+        sum += Uniform(seed);
+    return sum - 6;
+}
+
+/**
+ * Arrivals sorted by arrival time. Timestamps count ticks of tick_us
+ * microseconds: EKF and UKF take microseconds, EKF_CTRV uses timestamp
+ * differences as its time step directly (main.cpp feeds it frame numbers)
+ * and gets 25 ms ticks. The late sensor is the radar, or a second lidar
+ * when late_radar is false.
+ */
+std::vector<Arrival> MakeArrivals(long frames, double tick_us, bool late_radar) {
+    std::vector<Arrival> arrivals;
+    unsigned int seed = 11;
+    const double w = 0.2, r = 30, cx = 40, cy = 10;
+    for (long i = 0; i < 2 * frames; ++i) {
+        const double t = 0.025 * i;
+        const Eigen::Vector4d x(cx + r * cos(w * t), cy + r * sin(w * t),
+                                -r * w * sin(w * t), r * w * cos(w * t));
+        Arrival a;
+        a.meas.timestamp_ = 1000 + t * 1e6 / tick_us;
+        a.truth = x.head<2>();
+        a.on_time = i % 2 == 0;
+        if (i % 2 == 0 || !late_radar) {
+            a.meas.sensor_type_ = MeasurementPackage::LASER;
+            a.meas.raw_measurements_ = Eigen::VectorXd(2);
+            a.meas.raw_measurements_ << x[0] + 0.15 * Gaussian(seed), x[1] + 0.15 * Gaussian(seed);
+            a.arrival_us = t * 1e6;
+            if (i % 2)
+                a.arrival_us += 30000 + 100000 * Uniform(seed);
+        } else {
+            const double rho = sqrt(x[0] * x[0] + x[1] * x[1]);
+            const double phi = atan2(x[1], x[0]);
+            const double rho_dot = (x[0] * x[2] + x[1] * x[3]) / rho;
+            a.meas.sensor_type_ = MeasurementPackage::RADAR;
+            a.meas.raw_measurements_ = Eigen::VectorXd(3);
+            a.meas.raw_measurements_ << rho + 0.3 * Gaussian(seed), phi + 0.03 * Gaussian(seed),
+                rho_dot + 0.3 * Gaussian(seed);
+            a.arrival_us = t * 1e6 + 30000 + 100000 * Uniform(seed);
+        }
+        arrivals.push_back(a);
+    }
+    std::stable_sort(arrivals.begin(), arrivals.end(), EarlierArrival);
+    return arrivals;
+}
+
+/**
+ * @return the final state
+ */
+template <typename Filter>
+Eigen::VectorXd Run(const char *label, const std::vector<Arrival> &arrivals, int depth,
+                    typename Filter::History::Mode mode) {
+    Filter filter;
+    filter.oosm().setDepth(depth);
+    filter.oosm().setMode(mode);
+    // EKF and UKF fill the first four entries
+    Eigen::VectorXd state = Eigen::VectorXd::Zero(5);
+    double sum = 0;
+    long frames = 0;
+
+    BenchTimer timer;
+    for (size_t i = 0; i < arrivals.size(); ++i) {
+        filter.ProcessMeasurement(arrivals[i].meas);
+        if (arrivals[i].on_time && i > 100) {
+            filter.getState(state);
+            sum += (state.head<2>() - arrivals[i].truth).squaredNorm();
+            ++frames;
+        }
+    }
+    const double seconds = timer.Seconds();
+
+    BenchReport(label, arrivals.size(), seconds);
+    std::cout << "    position RMSE " << std::setprecision(4) << sqrt(sum / frames);
+    if (depth > 0)
+        std::cout << ", replays " << filter.oosm().replays() << " (" << filter.oosm().replayedSteps()
+                  << " steps), retrodictions " << filter.oosm().retrodictions()
+                  << ", dropped " << filter.oosm().lateDrops();
+    std::cout << std::endl;
+    filter.getState(state);
+    return state;
+}
+
+template <typename Filter>
+void Compare(const char *name, long frames, double tick_us, bool late_radar) {
+    std::vector<Arrival> arrivals = MakeArrivals(frames, tick_us, late_radar);
+    std::vector<Arrival> sorted = arrivals;
+    std::stable_sort(sorted.begin(), sorted.end(), EarlierTimestamp);
+
+    typedef typename Filter::History History;
+    std::cout << name << std::endl;
+    const Eigen::VectorXd in_order = Run<Filter>("  in order", sorted, 0, History::AUTO);
+    Run<Filter>("  late, no OOSM", arrivals, 0, History::AUTO);
+    const Eigen::VectorXd replayed = Run<Filter>("  late, replay", arrivals, 16, History::REPLAY);
+    std::cout << "    final state " << (replayed == in_order ? "identical to" : "DIFFERS from")
+              << " in order" << std::endl;
+    Run<Filter>("  late, retrodict", arrivals, 16, History::RETRODICT);
+    Run<Filter>("  late, auto", arrivals, 16, History::AUTO);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long frames = BenchIterations(argc, argv, 20000);
+    std::cout << frames << " lidar and " << frames << " radar measurements" << std::endl;
+    Compare<EKF>("EKF", frames, 1, true);
+    Compare<EKF_CTRV>("EKF_CTRV (late lidar)", frames, 25000, false);
+    Compare<UKF>("UKF", frames, 1, true);
+    return 0;
+}
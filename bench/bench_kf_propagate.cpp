@@ -0,0 +1,93 @@
+// Dense F*P*F^T against the block kernels of kf_propagate.h and their
+// packed-storage versions in kf_sym_packed.h, for the CV (4x4) and CTRV
+// (5x5) transitions.
+
+#include "bench_util.h"
+#include "kf_propagate.h"
+#include "kf_sym_packed.h"
+
+namespace {
+
+template <int N>
+Eigen::Matrix<double, N, N> RandomCovariance() {
+    Eigen::Matrix<double, N, N> A = Eigen::Matrix<double, N, N>::Random();
+    return A * A.transpose() + Eigen::Matrix<double, N, N>::Identity();
+}
+
+template <int N, typename Block>
+void Run(const char *label, const Eigen::Matrix<double, N, N> &F, Block block, long iterations) {
+    typedef SymPacked<N> Packed;
+    typedef Eigen::Matrix<double, N, N> Matrix;
+    const Matrix base = RandomCovariance<N>();
+    // a little noise per call so that neither loop can be hoisted
+    const Matrix nudge = Matrix::Identity() * 1e-12;
+
+    Matrix dense = base;
+    BenchTimer timer;
+    for (long i = 0; i < iterations; ++i) {
+        Matrix P = base + (i & 1) * nudge;
+        dense = F * P * F.transpose();
+        BenchKeep(dense);
+    }
+    double dense_seconds = timer.Seconds();
+
+    Matrix blocked = base;
+    timer.Reset();
+    for (long i = 0; i < iterations; ++i) {
+        blocked = base + (i & 1) * nudge;
+        block(blocked);
+        BenchKeep(blocked);
+    }
+    double block_seconds = timer.Seconds();
+
+    const Packed packed_base[2] = { Packed(base), Packed(Matrix(base + nudge)) };
+    Packed packed = packed_base[0];
+    timer.Reset();
+    for (long i = 0; i < iterations; ++i) {
+        packed = packed_base[i & 1];
+        block(packed);
+        BenchKeep(packed);
+    }
+    double packed_seconds = timer.Seconds();
+
+    std::cout << label << std::endl;
+    BenchReport("  dense", iterations, dense_seconds);
+    BenchReport("  block", iterations, block_seconds);
+    BenchReport("  packed", iterations, packed_seconds);
+    std::cout << "  max |dP| / max |P|: block " << std::scientific << std::setprecision(2)
+              << (dense - blocked).cwiseAbs().maxCoeff() / dense.cwiseAbs().maxCoeff()
+              << " packed " << (dense - packed.ToDense()).cwiseAbs().maxCoeff() / dense.cwiseAbs().maxCoeff()
+              << "  asymmetry dense " << (dense - dense.transpose()).cwiseAbs().maxCoeff()
+              << " block " << (blocked - blocked.transpose()).cwiseAbs().maxCoeff()
+              << std::fixed << std::endl;
+}
+
+const double kDeltaT = 0.05;
+
+struct CV {
+    void operator()(Eigen::Matrix4d &P) const { kf_propagate::PropagateCV(P, kDeltaT); }
+    void operator()(SymPacked<4> &P) const { kf_packed::PropagateCV(P, kDeltaT); }
+};
+
+struct CTRV {
+    Eigen::Matrix<double, 5, 5> JA;
+    void operator()(Eigen::Matrix<double, 5, 5> &P) const { kf_propagate::PropagateCTRV(P, JA); }
+    void operator()(SymPacked<5> &P) const { kf_packed::PropagateCTRV(P, JA); }
+};
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 10000000);
+
+    Eigen::Matrix4d F = Eigen::Matrix4d::Identity();
+    F(0, 2) = F(1, 3) = kDeltaT;
+    Run<4>("CV, 4x4", F, CV(), iterations);
+
+    CTRV ctrv;
+    ctrv.JA = Eigen::Matrix<double, 5, 5>::Identity();
+    ctrv.JA.block<2, 3>(0, 2) = Eigen::Matrix<double, 2, 3>::Random();
+    ctrv.JA(3, 4) = kDeltaT;
+    Run<5>("CTRV, 5x5", ctrv.JA, ctrv, iterations);
+    return 0;
+}
@@ -0,0 +1,136 @@
+// CV radar model h(x) and Jacobian H(x): the pair EKF used to run per radar
+// frame (CalculateJacobian_cv, float, then the h(x) evaluation inside
+// KF_FIXED::UpdateEKF) against the fused kf_radar::MeasurementCV, alone
+// and inside a full radar update. Reports the largest difference between
+// the two (the old pair rounds through float).
+// The first argument sets the number of evaluations (default 10000000).
+
+#include "bench_util.h"
+#include "kf_fixed.h"
+#include "kf_radar.h"
+#include <vector>
+
+namespace {
+
+// the Jacobian as EKF computed it before kf_radar
+Eigen::Matrix<double, 3, 4> CalculateJacobian_cv(const Eigen::Vector4d &x_state) {
+    Eigen::Matrix<double, 3, 4> Hj;
+    float px = x_state(0);
+    float py = x_state(1);
+    float vx = x_state(2);
+    float vy = x_state(3);
+    float c1 = px * px + py * py;
+    float c2 = sqrt(c1);
+    float c3 = (c1 * c2);
+    if (fabs(c1) < 0.0001) {
+        std::cout << "CalculateJacobian () - Error - Division by Zero" << std::endl;
+        return Hj;
+    }
+    Hj << (px / c2), (py / c2), 0, 0,
+        -(py / c1), (px / c1), 0, 0,
+        py * (vx * py - vy * px) / c3, px * (px * vy - py * vx) / c3, px / c2, py / c2;
+    return Hj;
+}
+
+// h(x) as KF_FIXED::UpdateEKF evaluates it
+Eigen::Vector3d RadarPrediction(const Eigen::Vector4d &x) {
+    float px = x[0];
+    float py = x[1];
+    float vx = x[2];
+    float vy = x[3];
+    float c1 = px * px + py * py;
+    float rho = sqrt(c1);
+    if (rho < 0.000001)
+        rho = 0.000001;
+    float phi = atan2(py, px);
+    float rho_dot = (px * vx + py * vy) / rho;
+    return Eigen::Vector3d(rho, phi, rho_dot);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long n = BenchIterations(argc, argv, 10000000);
+    std::vector<Eigen::Vector4d, Eigen::aligned_allocator<Eigen::Vector4d> > states(1024);
+    std::vector<Eigen::Vector3d, Eigen::aligned_allocator<Eigen::Vector3d> > measurements(1024);
+    unsigned int seed = 5;
+    for (size_t i = 0; i < states.size(); ++i) {
+        for (int k = 0; k < 4; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            states[i][k] = ((seed >> 8) * (1.0 / 16777216.0) - 0.5) * (k < 2 ? 60 : 20);
+        }
+        measurements[i] = RadarPrediction(states[i]) + Eigen::Vector3d(0.1, 0.01, 0.1);
+    }
+
+    double max_dh = 0, max_dH = 0;
+    for (size_t i = 0; i < states.size(); ++i) {
+        Eigen::Vector3d h;
+        Eigen::Matrix<double, 3, 4> H;
+        if (!kf_radar::MeasurementCV(states[i], h, H))
+            continue;
+        max_dh = std::max(max_dh, (h - RadarPrediction(states[i])).cwiseAbs().maxCoeff() / h.cwiseAbs().maxCoeff());
+        max_dH = std::max(max_dH, (H - CalculateJacobian_cv(states[i])).cwiseAbs().maxCoeff() / H.cwiseAbs().maxCoeff());
+    }
+
+    Eigen::Vector3d h_sum = Eigen::Vector3d::Zero();
+    Eigen::Matrix<double, 3, 4> H_sum = Eigen::Matrix<double, 3, 4>::Zero();
+    BenchTimer timer;
+    for (long i = 0; i < n; ++i) {
+        const Eigen::Vector4d &x = states[i & 1023];
+        H_sum += CalculateJacobian_cv(x);
+        h_sum += RadarPrediction(x);
+    }
+    const double pair_seconds = timer.Seconds();
+    BenchKeep(h_sum);
+    BenchKeep(H_sum);
+
+    timer.Reset();
+    for (long i = 0; i < n; ++i) {
+        Eigen::Vector3d h;
+        Eigen::Matrix<double, 3, 4> H;
+        if (kf_radar::MeasurementCV(states[i & 1023], h, H)) {
+            h_sum += h;
+            H_sum += H;
+        }
+    }
+    const double fused_seconds = timer.Seconds();
+    BenchKeep(h_sum);
+    BenchKeep(H_sum);
+
+    // full radar update on a fresh copy of the filter each time
+    KF_FIXED<4> base;
+    base.P_ = Eigen::Matrix4d::Identity() * 0.5;
+    Eigen::Matrix3d R;
+    R << 0.09, 0, 0, 0, 0.0009, 0, 0, 0, 0.09;
+    Eigen::Vector4d x_sum = Eigen::Vector4d::Zero();
+    const long updates = n / 10;
+    timer.Reset();
+    for (long i = 0; i < updates; ++i) {
+        KF_FIXED<4> kf = base;
+        kf.x_ = states[i & 1023];
+        kf.UpdateEKF(measurements[i & 1023], CalculateJacobian_cv(kf.x_), R);
+        x_sum += kf.x_;
+    }
+    const double update_pair_seconds = timer.Seconds();
+    BenchKeep(x_sum);
+
+    timer.Reset();
+    for (long i = 0; i < updates; ++i) {
+        KF_FIXED<4> kf = base;
+        kf.x_ = states[i & 1023];
+        kf.UpdateRadarCV(measurements[i & 1023], R);
+        x_sum += kf.x_;
+    }
+    const double update_fused_seconds = timer.Seconds();
+    BenchKeep(x_sum);
+
+    std::cout << "h(x) and H(x)" << std::endl;
+    BenchReport("  CalculateJacobian_cv + h(x)", n, pair_seconds);
+    BenchReport("  kf_radar::MeasurementCV", n, fused_seconds);
+    std::cout << "radar update" << std::endl;
+    BenchReport("  UpdateEKF(CalculateJacobian_cv)", updates, update_pair_seconds);
+    BenchReport("  UpdateRadarCV", updates, update_fused_seconds);
+    std::cout << "largest relative difference: h " << std::scientific << std::setprecision(2) << max_dh
+              << ", H " << max_dH << std::endl;
+    return 0;
+}
@@ -0,0 +1,74 @@
+// Joint update against the sequential scalar update for diagonal R, for
+// 2-, 3- and 4-dimensional measurements on the 4-state CV filter.
+
+#include "bench_util.h"
+#include "kf_fixed.h"
+#include <vector>
+
+namespace {
+
+template <int NZ>
+void Run(const char *label, const Eigen::Matrix<double, NZ, 4> &H,
+    const Eigen::Matrix<double, NZ, 1> &r, long iterations) {
+    typedef Eigen::Matrix<double, NZ, 1> Measurement;
+    const Eigen::Matrix<double, NZ, NZ> R = r.asDiagonal();
+
+    KF_FIXED<4> base;
+    Eigen::Matrix4d A = Eigen::Matrix4d::Random();
+    base.P_ = A * A.transpose() + Eigen::Matrix4d::Identity();
+    base.x_ = Eigen::Vector4d::Random();
+    std::vector<Measurement> innovations(256);
+    for (size_t i = 0; i < innovations.size(); ++i)
+        innovations[i] = Measurement::Random();
+
+    KF_FIXED<4> joint, sequential;
+    Eigen::Vector4d sum = Eigen::Vector4d::Zero();
+    BenchTimer timer;
+    for (long i = 0; i < iterations; ++i) {
+        joint = base;
+        joint.KalmanFilter(innovations[i & 255], H, R);
+        sum += joint.x_;
+    }
+    double joint_seconds = timer.Seconds();
+    BenchKeep(sum);
+
+    sum.setZero();
+    timer.Reset();
+    for (long i = 0; i < iterations; ++i) {
+        sequential = base;
+        sequential.sequential_update_ = true;
+        sequential.KalmanFilter(innovations[i & 255], H, R);
+        sum += sequential.x_;
+    }
+    double sequential_seconds = timer.Seconds();
+    BenchKeep(sum);
+
+    std::cout << label << std::endl;
+    BenchReport("  joint update", iterations, joint_seconds);
+    BenchReport("  sequential update", iterations, sequential_seconds);
+    std::cout << "  max |dx| " << std::scientific << std::setprecision(2)
+              << (joint.x_ - sequential.x_).cwiseAbs().maxCoeff()
+              << "  max |dP| " << (joint.P_ - sequential.P_).cwiseAbs().maxCoeff() << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long iterations = BenchIterations(argc, argv, 5000000);
+
+    Eigen::Matrix<double, 2, 4> H_laser;
+    H_laser << 1, 0, 0, 0,
+               0, 1, 0, 0;
+    Run<2>("NZ=2 lidar", H_laser, Eigen::Vector2d(0.0225, 0.0225), iterations);
+
+    // radar Jacobian at px = 3, py = 4, vx = 1, vy = 2
+    Eigen::Matrix<double, 3, 4> H_radar;
+    H_radar << 0.6, 0.8, 0, 0,
+               -0.16, 0.12, 0, 0,
+               0.064, -0.048, 0.6, 0.8;
+    Run<3>("NZ=3 radar (EKF)", H_radar, Eigen::Vector3d(0.09, 0.0009, 0.09), iterations);
+
+    Run<4>("NZ=4 cartesian radar", Eigen::Matrix4d::Identity(),
+        Eigen::Vector4d(0.09, 0.09, 1.69, 1.69), iterations);
+    return 0;
+}
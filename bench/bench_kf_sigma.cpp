@@ -0,0 +1,129 @@
+// UKF augmented sigma point generation alone, three ways:
+//   dynamic 7x7   the original AugmentedSigmaPoints: MatrixXd P_aug, a
+//                 full 7x7 LLT and sqrt(lambda + n_aug) in the loop
+//   fixed 7x7     the same on fixed-size matrices
+//   UKF           UKF::AugmentedSigmaPoints: the 5x5 block of P_aug
+//                 factorised, the noise columns written directly
+// Each timing is the best of five rounds, the three taking turns within a
+// round, over 256 different covariances;
+// the largest difference from the dynamic version is reported.
+// The first argument sets the number of calls (default 2000000).
+
+#include "bench_util.h"
+#include "ukf.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+typedef UKF::StateVector Vector5d;
+typedef UKF::StateMatrix Matrix5d;
+typedef Eigen::Matrix<double, 7, 15> Matrix7x15d;
+
+void DynamicSigmaPoints(const UKF &ukf, Eigen::MatrixXd *Xsig_out) {
+    const int n_aug = ukf.n_aug_;
+    Eigen::VectorXd x_aug = Eigen::VectorXd(7);
+    Eigen::MatrixXd P_aug = Eigen::MatrixXd(7, 7);
+    Eigen::MatrixXd Xsig_aug = Eigen::MatrixXd(n_aug, 2 * n_aug + 1);
+    x_aug.head(5) = ukf.x_;
+    x_aug(5) = 0;
+    x_aug(6) = 0;
+    P_aug.fill(0.0);
+    P_aug.topLeftCorner(5, 5) = ukf.P_;
+    P_aug(5, 5) = ukf.std_a_ * ukf.std_a_;
+    P_aug(6, 6) = ukf.std_yawdd_ * ukf.std_yawdd_;
+    Eigen::MatrixXd A = P_aug.llt().matrixL();
+    Xsig_aug.col(0) = x_aug;
+    for (int i = 0; i < n_aug; i++) {
+        Xsig_aug.col(i + 1) = x_aug + sqrt(ukf.lambda_ + n_aug) * A.col(i);
+        Xsig_aug.col(i + 1 + n_aug) = x_aug - sqrt(ukf.lambda_ + n_aug) * A.col(i);
+    }
+    *Xsig_out = Xsig_aug;
+}
+
+void FixedSigmaPoints(const UKF &ukf, Matrix7x15d *Xsig_out) {
+    Eigen::Matrix<double, 7, 1> x_aug;
+    Eigen::Matrix<double, 7, 7> P_aug;
+    x_aug.head<5>() = ukf.x_;
+    x_aug(5) = 0;
+    x_aug(6) = 0;
+    P_aug.fill(0.0);
+    P_aug.topLeftCorner<5, 5>() = ukf.P_;
+    P_aug(5, 5) = ukf.std_a_ * ukf.std_a_;
+    P_aug(6, 6) = ukf.std_yawdd_ * ukf.std_yawdd_;
+    const Eigen::LLT<Eigen::Matrix<double, 7, 7> > llt(P_aug);
+    const Eigen::Matrix<double, 7, 7> A = sqrt(ukf.lambda_ + ukf.n_aug_) * llt.matrixL().toDenseMatrix();
+    Matrix7x15d &Xsig_aug = *Xsig_out;
+    Xsig_aug.col(0) = x_aug;
+    Xsig_aug.block<7, 7>(0, 1) = A.colwise() + x_aug;
+    Xsig_aug.block<7, 7>(0, 8) = (-A).colwise() + x_aug;
+}
+
+template <typename Body>
+void Time(long n, Body body, double &best) {
+    BenchTimer timer;
+    for (long i = 0; i < n; ++i)
+        body(i);
+    best = std::min(best, timer.Seconds());
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long n = BenchIterations(argc, argv, 2000000);
+
+    // 256 filters with different states and covariances P = B*B^T + 0.1*I
+    std::vector<UKF, Eigen::aligned_allocator<UKF> > filters(256);
+    unsigned int seed = 5;
+    for (size_t f = 0; f < filters.size(); ++f) {
+        Matrix5d B;
+        for (int k = 0; k < 25; ++k) {
+            seed = seed * 1664525u + 1013904223u;
+            B(k) = (seed >> 8) * (1.0 / 16777216.0) - 0.5;
+        }
+        filters[f].P_ = B * B.transpose() + 0.1 * Matrix5d::Identity();
+        filters[f].x_ = B.col(0) * 10;
+    }
+
+    double difference = 0;
+    for (size_t f = 0; f < filters.size(); ++f) {
+        Eigen::MatrixXd dynamic;
+        Matrix7x15d fixed;
+        UKF::AugmentedSigmaMatrix ukf;
+        DynamicSigmaPoints(filters[f], &dynamic);
+        FixedSigmaPoints(filters[f], &fixed);
+        filters[f].AugmentedSigmaPoints(&ukf);
+        difference = std::max(difference, (fixed - dynamic).cwiseAbs().maxCoeff());
+        difference = std::max(difference, (ukf - dynamic).cwiseAbs().maxCoeff());
+    }
+
+    Eigen::MatrixXd dynamic_sum = Eigen::MatrixXd::Zero(7, 15);
+    Matrix7x15d sum = Matrix7x15d::Zero();
+    double dynamic_seconds = 1e300, fixed_seconds = 1e300, ukf_seconds = 1e300;
+    for (int round = 0; round < 5; ++round) {
+        Time(n, [&](long i) {
+            Eigen::MatrixXd Xsig;
+            DynamicSigmaPoints(filters[i & 255], &Xsig);
+            dynamic_sum += Xsig;
+        }, dynamic_seconds);
+        Time(n, [&](long i) {
+            Matrix7x15d Xsig;
+            FixedSigmaPoints(filters[i & 255], &Xsig);
+            sum += Xsig;
+        }, fixed_seconds);
+        Time(n, [&](long i) {
+            UKF::AugmentedSigmaMatrix Xsig;
+            filters[i & 255].AugmentedSigmaPoints(&Xsig);
+            sum += Xsig;
+        }, ukf_seconds);
+    }
+    BenchReport("dynamic 7x7", n, dynamic_seconds);
+    BenchReport("fixed 7x7", n, fixed_seconds);
+    BenchReport("UKF::AugmentedSigmaPoints", n, ukf_seconds);
+    std::cout << "largest difference from dynamic 7x7 " << std::scientific << std::setprecision(2) << difference
+              << std::endl;
+
+    BenchKeep(dynamic_sum);
+    BenchKeep(sum);
+    return 0;
+}
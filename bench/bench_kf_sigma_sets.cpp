@@ -0,0 +1,132 @@
+// Accuracy against throughput of the UKF sigma point sets
+// (UKF::setSigmaPoints): the Julier set (15 points), the spherical simplex
+// set (9) and the cubature set (14). Each set runs
+// data/data_synthetic.txt (run from the build directory), replayed many
+// times back to back, with all measurements and with the radar ones only,
+// which go through the sigma points at every update (lidar updates are
+// linear and cost the same for every set).
+// Reports the cost of one prediction, then per stream the cost per
+// measurement (best of three rounds, the sets taking turns within a round),
+// the position and velocity RMSE against the ground truth and the largest
+// state difference from the Julier set.
+// The first argument sets the number of copies (default 2000).
+
+#include "bench_util.h"
+#include "ukf.h"
+#include <algorithm>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+typedef std::vector<Eigen::Vector4d, Eigen::aligned_allocator<Eigen::Vector4d> > States;
+
+std::unique_ptr<UKF> MakeFilter(const UKF::SigmaPoints &set) {
+    std::unique_ptr<UKF> ukf(new UKF);
+    ukf->setSigmaPoints(set);
+    return ukf;
+}
+
+double Replay(const std::vector<BenchFrame> &stream, const UKF::SigmaPoints &set) {
+    std::unique_ptr<UKF> ukf = MakeFilter(set);
+    BenchTimer timer;
+    for (size_t i = 0; i < stream.size(); ++i)
+        ukf->ProcessMeasurement(stream[i].meas);
+    const double seconds = timer.Seconds();
+    BenchKeep(ukf->x_);
+    return seconds;
+}
+
+States Track(const std::vector<BenchFrame> &stream, const UKF::SigmaPoints &set) {
+    std::unique_ptr<UKF> ukf = MakeFilter(set);
+    States states(stream.size());
+    Eigen::VectorXd state(4);
+    for (size_t i = 0; i < stream.size(); ++i) {
+        ukf->ProcessMeasurement(stream[i].meas);
+        ukf->getState(state);
+        states[i] = state;
+    }
+    return states;
+}
+
+/**
+ * One prediction of 50 ms from a filter part way through the recording,
+ * restoring x_ and P_ before each call
+ */
+double PredictionCost(const std::vector<BenchFrame> &recording, const UKF::SigmaPoints &set, long n) {
+    std::unique_ptr<UKF> ukf = MakeFilter(set);
+    for (size_t i = 0; i < recording.size() / 2; ++i)
+        ukf->ProcessMeasurement(recording[i].meas);
+    const UKF::StateVector x = ukf->x_;
+    const UKF::StateMatrix P = ukf->P_;
+    UKF::StateVector sum = UKF::StateVector::Zero();
+    BenchTimer timer;
+    for (long i = 0; i < n; ++i) {
+        ukf->x_ = x;
+        ukf->P_ = P;
+        ukf->Prediction(0.05);
+        sum += ukf->x_;
+    }
+    const double seconds = timer.Seconds();
+    BenchKeep(sum);
+    return seconds;
+}
+
+void Compare(const char *label, const std::vector<BenchFrame> &stream, const std::vector<UKF::SigmaPoints> &sets) {
+    std::vector<double> seconds(sets.size(), 1e300);
+    for (int round = 0; round < 3; ++round)
+        for (size_t s = 0; s < sets.size(); ++s)
+            seconds[s] = std::min(seconds[s], Replay(stream, sets[s]));
+
+    std::cout << label << ", " << stream.size() << " measurements" << std::endl;
+    const States julier = Track(stream, sets[0]);
+    for (size_t s = 0; s < sets.size(); ++s) {
+        const States states = s == 0 ? julier : Track(stream, sets[s]);
+        Eigen::Vector4d sum = Eigen::Vector4d::Zero();
+        double difference = 0;
+        for (size_t i = 0; i < stream.size(); ++i) {
+            const Eigen::Vector4d e = states[i] - stream[i].truth;
+            sum += e.cwiseProduct(e);
+            difference = std::max(difference, (states[i] - julier[i]).cwiseAbs().maxCoeff());
+        }
+        const Eigen::Vector4d rmse = (sum / double(stream.size())).cwiseSqrt();
+        BenchReport("  " + std::string(sets[s].name()), stream.size(), seconds[s]);
+        std::cout << "    RMSE px " << std::setprecision(4) << rmse[0] << " py " << rmse[1] << " vx " << rmse[2]
+                  << " vy " << rmse[3] << ", largest difference from Julier " << std::scientific
+                  << std::setprecision(2) << difference << std::fixed << std::endl;
+    }
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long copies = BenchIterations(argc, argv, 2000);
+    std::vector<BenchFrame> recording;
+    if (!BenchLoadSynthetic(recording))
+        return 1;
+
+    const UKF ukf;
+    std::vector<UKF::SigmaPoints> sets;
+    sets.push_back(UKF::SigmaPoints::Julier(ukf.lambda_));
+    sets.push_back(UKF::SigmaPoints::Simplex());
+    sets.push_back(UKF::SigmaPoints::Cubature());
+
+    const long predictions = copies * 500;
+    std::vector<double> seconds(sets.size(), 1e300);
+    for (int round = 0; round < 3; ++round)
+        for (size_t s = 0; s < sets.size(); ++s)
+            seconds[s] = std::min(seconds[s], PredictionCost(recording, sets[s], predictions));
+    std::cout << "prediction" << std::endl;
+    for (size_t s = 0; s < sets.size(); ++s) {
+        std::ostringstream label;
+        label << "  " << sets[s].name() << " (" << sets[s].size() << " points)";
+        BenchReport(label.str(), predictions, seconds[s]);
+    }
+
+    Compare("all measurements", BenchScaleUp(recording, copies), sets);
+    Compare("radar only", BenchScaleUp(recording, copies, [](const BenchFrame &frame) {
+        return frame.meas.sensor_type_ == MeasurementPackage::RADAR;
+    }), sets);
+    return 0;
+}
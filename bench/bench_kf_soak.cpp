@@ -0,0 +1,97 @@
+// Long-run soak of the covariance update forms (kf_update::CovarianceUpdate):
+// a 4-state CV track with a precise position sensor, predicted and updated
+// N times (default 1e8, first argument). Reports the cost per predict+update
+// and how the smallest eigenvalue of P and its asymmetry evolve, for a 1 mm
+// and a 1 um sensor; the latter drives float P indefinite unless the update
+// is in Joseph form.
+
+#include "bench_util.h"
+#include "kf_fixed.h"
+#include <limits>
+
+namespace {
+
+template <typename Scalar>
+struct Soak {
+    typedef Eigen::Matrix<Scalar, 4, 4> Matrix4;
+    typedef Eigen::Matrix<Scalar, 2, 1> Vector2;
+
+    static Scalar MinEigenvalue(const Matrix4 &P) {
+        Matrix4 sym = (P + P.transpose()) / 2;
+        Eigen::SelfAdjointEigenSolver<Matrix4> solver(sym, Eigen::EigenvaluesOnly);
+        return solver.eigenvalues()[0];
+    }
+
+    static void Run(const char *label, kf_update::CovarianceUpdate form, double sigma, long updates) {
+        const Scalar dt = Scalar(0.01);
+        KF_FIXED<4, Scalar> kf;
+        kf.covariance_update_ = form;
+        kf.F_(0, 2) = kf.F_(1, 3) = dt;
+        // small process noise and a precise sensor drive P close to singular
+        const Scalar q = Scalar(1e-4);
+        kf.Q_ << dt*dt*dt*dt / 4 * q, 0, dt*dt*dt / 2 * q, 0,
+            0, dt*dt*dt*dt / 4 * q, 0, dt*dt*dt / 2 * q,
+            dt*dt*dt / 2 * q, 0, dt*dt*q, 0,
+            0, dt*dt*dt / 2 * q, 0, dt*dt*q;
+        Eigen::Matrix<Scalar, 2, 4> H;
+        H << 1, 0, 0, 0,
+            0, 1, 0, 0;
+        Eigen::Matrix<Scalar, 2, 2> R = Eigen::Matrix<Scalar, 2, 2>::Identity() * Scalar(sigma*sigma);
+        kf.x_ << 0, 0, 1, 0.5;
+
+        // deterministic measurement noise of about +-sigma
+        unsigned int seed = 12345;
+        Vector2 z;
+        const long samples = 100;
+        const long stride = std::max(1L, updates / samples);
+        Scalar start_eig = 0, min_eig = std::numeric_limits<Scalar>::max(), max_asym = 0;
+        double seconds = 0;
+        BenchTimer timer;
+        for (long i = 0; i < updates; ++i) {
+            kf.PredictCV();
+            seed = seed * 1664525u + 1013904223u;
+            const Scalar noise = Scalar((seed >> 8) * (1.0 / 16777216.0) - 0.5) * Scalar(2 * sigma);
+            z << kf.x_[0] + noise, kf.x_[1] - noise;
+            kf.Update(z, H, R);
+            if ((i + 1) % stride == 0) {
+                seconds += timer.Seconds();
+                Scalar eig = MinEigenvalue(kf.P_);
+                if (i + 1 == stride)
+                    start_eig = eig;
+                min_eig = std::min(min_eig, eig);
+                max_asym = std::max(max_asym, (kf.P_ - kf.P_.transpose()).cwiseAbs().maxCoeff());
+                timer.Reset();
+            }
+        }
+        seconds += timer.Seconds();
+
+        BenchReport(label, updates, seconds);
+        std::cout << std::scientific << std::setprecision(3)
+                  << "    min eigenvalue: after " << stride << " updates " << start_eig
+                  << ", lowest " << min_eig << ", final " << MinEigenvalue(kf.P_)
+                  << "; max |P - P^T| " << max_asym << std::fixed << std::endl;
+    }
+};
+
+}
+
+int main(int argc, char *argv[]) {
+    const long updates = BenchIterations(argc, argv, 100000000);
+    std::cout << updates << " predict+update steps per form" << std::endl;
+
+    const double sigmas[] = { 1e-3, 1e-6 };
+    for (int k = 0; k < 2; ++k) {
+        const double sigma = sigmas[k];
+        std::cout << "sensor sigma " << std::scientific << std::setprecision(0) << sigma
+                  << std::fixed << std::endl;
+        std::cout << " double" << std::endl;
+        Soak<double>::Run("  standard  P -= K*H*P", kf_update::STANDARD_UPDATE, sigma, updates);
+        Soak<double>::Run("  symmetric P -= K*S*K^T", kf_update::SYMMETRIC_UPDATE, sigma, updates);
+        Soak<double>::Run("  Joseph", kf_update::JOSEPH_UPDATE, sigma, updates);
+        std::cout << " float" << std::endl;
+        Soak<float>::Run("  standard  P -= K*H*P", kf_update::STANDARD_UPDATE, sigma, updates);
+        Soak<float>::Run("  symmetric P -= K*S*K^T", kf_update::SYMMETRIC_UPDATE, sigma, updates);
+        Soak<float>::Run("  Joseph", kf_update::JOSEPH_UPDATE, sigma, updates);
+    }
+    return 0;
+}
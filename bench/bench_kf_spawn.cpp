@@ -0,0 +1,55 @@
+// Track spawn rate: constructing KF_FUSION and EKF_CTRV filters from the
+// shared FilterConfig against parsing config.txt once per track, which is
+// what every constructor used to do. The first argument sets the number of
+// tracks per run (default 10000).
+// Run from the build directory so that ../config.txt is found.
+
+#include "bench_util.h"
+#include "ekf_ctrv.h"
+#include "kf_Fusion.h"
+#include "kf_config.h"
+#include <vector>
+
+namespace {
+
+template <typename Filter>
+void Spawn(const char *label, long tracks) {
+    std::vector<Filter *> filters(tracks);
+
+    BenchTimer timer;
+    for (long i = 0; i < tracks; ++i)
+        filters[i] = new Filter();
+    const double shared_seconds = timer.Seconds();
+    for (long i = 0; i < tracks; ++i)
+        delete filters[i];
+
+    std::string error;
+    timer.Reset();
+    for (long i = 0; i < tracks; ++i) {
+        std::shared_ptr<const FilterConfig> config = FilterConfig::Load("../config.txt", &error);
+        if (!config) {
+            std::cerr << error << std::endl;
+            return;
+        }
+        filters[i] = new Filter(config);
+    }
+    const double parsed_seconds = timer.Seconds();
+    for (long i = 0; i < tracks; ++i)
+        delete filters[i];
+
+    std::cout << label << std::endl;
+    BenchReport("  shared FilterConfig", tracks, shared_seconds);
+    BenchReport("  config.txt parsed per track", tracks, parsed_seconds);
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long tracks = BenchIterations(argc, argv, 10000);
+    // load the shared config outside the timed loops
+    FilterConfig::Default();
+    std::cout << tracks << " tracks per run" << std::endl;
+    Spawn<KF_FUSION>("KF_FUSION", tracks);
+    Spawn<EKF_CTRV>("EKF_CTRV", tracks);
+    return 0;
+}
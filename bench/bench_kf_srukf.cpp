@@ -0,0 +1,100 @@
+// Standard against square-root UKF (UKF::setSquareRoot) on
+// data/data_synthetic.txt (run from the build directory) replayed many
+// times back to back through one filter, so the target jumps back to the
+// start of the recording at every copy. Runs the default noise settings
+// and a tight one (process noise a tenth of the default).
+// Reports the cost per measurement (best of three replays), the position
+// and velocity RMSE against the ground truth, the failed factorisations of
+// each mode and the largest state difference between the two.
+// The first argument sets the number of copies (default 2000).
+
+#include "bench_util.h"
+#include "ukf.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+struct Run {
+    double seconds;
+    std::vector<Eigen::Vector4d, Eigen::aligned_allocator<Eigen::Vector4d> > states;
+    long failures;
+};
+
+std::unique_ptr<UKF> MakeFilter(bool square_root, double noise_scale) {
+    std::unique_ptr<UKF> ukf(new UKF);
+    ukf->std_a_ *= noise_scale;
+    ukf->std_yawdd_ *= noise_scale;
+    ukf->setSquareRoot(square_root);
+    return ukf;
+}
+
+Run Replay(const std::vector<BenchFrame> &stream, bool square_root, double noise_scale) {
+    Run run;
+    run.seconds = 1e300;
+    for (int pass = 0; pass < 3; ++pass) {
+        std::unique_ptr<UKF> ukf = MakeFilter(square_root, noise_scale);
+        BenchTimer timer;
+        for (size_t i = 0; i < stream.size(); ++i)
+            ukf->ProcessMeasurement(stream[i].meas);
+        run.seconds = std::min(run.seconds, timer.Seconds());
+        BenchKeep(ukf->x_);
+    }
+
+    std::unique_ptr<UKF> ukf = MakeFilter(square_root, noise_scale);
+    run.states.resize(stream.size());
+    Eigen::VectorXd state(4);
+    for (size_t i = 0; i < stream.size(); ++i) {
+        ukf->ProcessMeasurement(stream[i].meas);
+        ukf->getState(state);
+        run.states[i] = state;
+    }
+    run.failures = square_root ? ukf->downdateFailures() : ukf->lltFailures();
+    return run;
+}
+
+void Report(const char *label, const std::vector<BenchFrame> &stream, const Run &run, const char *failures) {
+    Eigen::Vector4d sum = Eigen::Vector4d::Zero();
+    long finite = 0;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        const Eigen::Vector4d e = run.states[i] - stream[i].truth;
+        if (e.allFinite()) {
+            sum += e.cwiseProduct(e);
+            ++finite;
+        }
+    }
+    const Eigen::Vector4d rmse = (sum / std::max(finite, 1L)).cwiseSqrt();
+    BenchReport(label, stream.size(), run.seconds);
+    std::cout << "    RMSE px " << std::setprecision(4) << rmse[0] << " py " << rmse[1] << " vx " << rmse[2]
+              << " vy " << rmse[3] << ", " << run.failures << " " << failures << ", "
+              << stream.size() - finite << " non-finite states" << std::endl;
+}
+
+void Compare(const char *label, const std::vector<BenchFrame> &stream, double noise_scale) {
+    const Run standard = Replay(stream, false, noise_scale);
+    const Run square_root = Replay(stream, true, noise_scale);
+    double difference = 0;
+    for (size_t i = 0; i < stream.size(); ++i)
+        difference = std::max(difference, (standard.states[i] - square_root.states[i]).cwiseAbs().maxCoeff());
+
+    std::cout << label << std::endl;
+    Report("  UKF", stream, standard, "LLT failures");
+    Report("  square-root UKF", stream, square_root, "failed downdates");
+    std::cout << "  largest state difference " << std::scientific << std::setprecision(2) << difference
+              << std::fixed << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long copies = BenchIterations(argc, argv, 2000);
+    std::vector<BenchFrame> recording;
+    if (!BenchLoadSynthetic(recording))
+        return 1;
+    const std::vector<BenchFrame> stream = BenchScaleUp(recording, copies);
+    std::cout << stream.size() << " measurements" << std::endl;
+    Compare("default process noise", stream, 1.0);
+    Compare("process noise x0.1", stream, 0.1);
+    return 0;
+}
@@ -0,0 +1,70 @@
+// KF_FUSION on a fixed-interval lidar stream (50 ms) with and without the
+// steady-state gain path, plus a stream whose interval changes every 500
+// frames to exercise the fallback. Reports the cost per frame, how many
+// frames used the cached gain and the largest state difference to the
+// full filter.
+
+#include "bench_util.h"
+#include "kf_Fusion.h"
+#include <vector>
+
+namespace {
+
+std::vector<MeasurementPackage> LidarStream(long frames, bool vary_interval) {
+    std::vector<MeasurementPackage> stream(frames);
+    unsigned int seed = 4711;
+    double t = 0;
+    for (long i = 0; i < frames; ++i) {
+        if (i > 0)
+            t += vary_interval && (i / 500) % 2 ? 40000 : 50000;
+        seed = seed * 1664525u + 1013904223u;
+        const double noise = ((seed >> 8) * (1.0 / 16777216.0) - 0.5) * 0.1;
+        MeasurementPackage &meas = stream[i];
+        meas.sensor_type_ = MeasurementPackage::LASER;
+        meas.timestamp_ = t;
+        meas.raw_measurements_ = Eigen::VectorXd(2);
+        // a target circling at 10 m/s, so the stream never settles
+        const double s = t * 1e-6;
+        meas.raw_measurements_ << 50 * cos(s / 5) + noise, 50 * sin(s / 5) - noise;
+    }
+    return stream;
+}
+
+double Run(KF_FUSION &filter, const std::vector<MeasurementPackage> &stream,
+    std::vector<Eigen::Vector4d> &states) {
+    states.resize(stream.size());
+    BenchTimer timer;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        filter.ProcessMeasurement(stream[i]);
+        states[i] = filter.ekf_.x_;
+    }
+    return timer.Seconds();
+}
+
+void Compare(const char *label, const std::vector<MeasurementPackage> &stream) {
+    std::vector<Eigen::Vector4d> full_states, steady_states;
+    KF_FUSION full, steady;
+    steady.setSteadyState(true);
+    const double full_seconds = Run(full, stream, full_states);
+    const double steady_seconds = Run(steady, stream, steady_states);
+
+    double max_dx = 0;
+    for (size_t i = 0; i < stream.size(); ++i)
+        max_dx = std::max(max_dx, (full_states[i] - steady_states[i]).cwiseAbs().maxCoeff());
+
+    std::cout << label << std::endl;
+    BenchReport("  full predict/update", stream.size(), full_seconds);
+    BenchReport("  steady-state gain", stream.size(), steady_seconds);
+    std::cout << "  steady-state frames " << steady.steadyStateUpdates() << " of " << stream.size()
+              << ", max |dx| " << std::scientific << std::setprecision(2) << max_dx
+              << std::fixed << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long frames = BenchIterations(argc, argv, 2000000);
+    Compare("fixed 50 ms lidar", LidarStream(frames, false));
+    Compare("lidar alternating 50/40 ms every 500 frames", LidarStream(frames, true));
+    return 0;
+}
@@ -0,0 +1,118 @@
+// F(dt)/Q(dt) built per measurement against CVTransitionCache lookups.
+// Replays data/data_synthetic.txt (run from the build directory) many times
+// over through EKF and KF_FUSION, dropping about one frame in ten so the
+// stream also has 100 and 150 ms gaps. Reports the cost of building F and Q
+// alone, the cost per measurement, the cache hit rate and checks that the
+// states match the uncached filters bit for bit.
+
+#include "bench_util.h"
+#include "ekf.h"
+#include "kf_Fusion.h"
+#include "kf_transition_cache.h"
+#include <vector>
+
+namespace {
+
+struct Frame {
+    MeasurementPackage polar;      // EKF: radar as (rho, phi, rho_dot)
+    MeasurementPackage cartesian;  // KF_FUSION: radar converted to (px, py, vx, vy)
+};
+
+/**
+ * copies of the recording back to back, with about one frame in ten
+ * dropped, and radar also converted for KF_FUSION
+ */
+std::vector<Frame> ScaleUp(const std::vector<BenchFrame> &recording, long copies) {
+    unsigned int seed = 99;
+    const std::vector<BenchFrame> kept = BenchScaleUp(recording, copies, [&seed](const BenchFrame &) {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 16) % 10 != 0;
+    });
+    std::vector<Frame> stream(kept.size());
+    for (size_t i = 0; i < kept.size(); ++i) {
+        const MeasurementPackage &meas = kept[i].meas;
+        Frame &frame = stream[i];
+        frame.polar = meas;
+        if (meas.sensor_type_ == MeasurementPackage::RADAR) {
+            const double rho = meas.raw_measurements_[0], phi = meas.raw_measurements_[1],
+                rho_dot = meas.raw_measurements_[2];
+            frame.cartesian.timestamp_ = meas.timestamp_;
+            frame.cartesian.sensor_type_ = MeasurementPackage::RADAR;
+            frame.cartesian.raw_measurements_ = Eigen::VectorXd(4);
+            frame.cartesian.raw_measurements_ << rho * cos(phi), rho * sin(phi),
+                rho_dot * cos(phi), rho_dot * sin(phi);
+        } else {
+            frame.cartesian = meas;
+        }
+    }
+    return stream;
+}
+
+template <typename Filter>
+double Replay(Filter &filter, const std::vector<Frame> &stream, bool polar, Eigen::Vector4d &checksum) {
+    checksum.setZero();
+    BenchTimer timer;
+    for (size_t i = 0; i < stream.size(); ++i) {
+        filter.ProcessMeasurement(polar ? stream[i].polar : stream[i].cartesian);
+        checksum += filter.ekf_.x_;
+    }
+    return timer.Seconds();
+}
+
+template <typename Filter>
+void Compare(const char *label, const std::vector<Frame> &stream, bool polar) {
+    CVTransitionCache cache(kCVNoiseVariance, kCVNoiseVariance);
+    Filter uncached, cached;
+    uncached.setTransitionCache(nullptr);
+    cached.setTransitionCache(&cache);
+    Eigen::Vector4d uncached_sum, cached_sum;
+    const double uncached_seconds = Replay(uncached, stream, polar, uncached_sum);
+    const double cached_seconds = Replay(cached, stream, polar, cached_sum);
+
+    std::cout << label << std::endl;
+    BenchReport("  F/Q built per measurement", stream.size(), uncached_seconds);
+    BenchReport("  F/Q from the cache", stream.size(), cached_seconds);
+    std::cout << "  hits " << cache.hits() << ", misses " << cache.misses() << " ("
+              << std::setprecision(4) << 100.0 * cache.hits() / (cache.hits() + cache.misses())
+              << "% hit rate), " << cache.size() << " intervals cached, states "
+              << (uncached_sum == cached_sum && uncached.ekf_.x_ == cached.ekf_.x_ ? "identical" : "DIFFER")
+              << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long copies = BenchIterations(argc, argv, 4000);
+    std::vector<BenchFrame> recording;
+    if (!BenchLoadSynthetic(recording))
+        return 1;
+    const std::vector<Frame> stream = ScaleUp(recording, copies);
+    std::cout << stream.size() << " measurements (" << copies << " copies of data_synthetic.txt)" << std::endl;
+
+    // F and Q alone, over the intervals of the stream
+    std::vector<double> intervals(stream.size() - 1);
+    for (size_t i = 1; i < stream.size(); ++i)
+        intervals[i - 1] = (stream[i].polar.timestamp_ - stream[i - 1].polar.timestamp_) / 1000000.0;
+    CVTransitionCache cache(kCVNoiseVariance, kCVNoiseVariance);
+    CVTransitionCache::Entry scratch;
+    Eigen::Matrix4d sum = Eigen::Matrix4d::Zero();
+    BenchTimer timer;
+    for (size_t i = 0; i < intervals.size(); ++i) {
+        CVTransitionCache::Compute(intervals[i], kCVNoiseVariance, kCVNoiseVariance, scratch);
+        sum += scratch.Q;
+    }
+    const double compute_seconds = timer.Seconds();
+    BenchKeep(sum);
+    timer.Reset();
+    for (size_t i = 0; i < intervals.size(); ++i)
+        sum += cache.Lookup(intervals[i], scratch).Q;
+    const double lookup_seconds = timer.Seconds();
+    BenchKeep(sum);
+    std::cout << "F and Q only" << std::endl;
+    BenchReport("  CVTransitionCache::Compute", intervals.size(), compute_seconds);
+    BenchReport("  CVTransitionCache::Lookup", intervals.size(), lookup_seconds);
+
+    Compare<EKF>("EKF::ProcessMeasurement", stream, true);
+    Compare<KF_FUSION>("KF_FUSION::ProcessMeasurement", stream, false);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Latency of UKF::ProcessMeasurement, one call at a time, over an
+// alternating lidar/radar stream 50 ms apart from a target driving a slow
+// S-curve. Each call is timed on its own; the report gives the mean, median
+// and 99th percentile per sensor and over all calls. Only the public
+// interface is used, so the same file measures any version of the UKF.
+// The first argument sets the number of measurements (default 200000).
+
+#include "bench_util.h"
+#include "ukf.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+std::vector<MeasurementPackage> MakeStream(long n) {
+    std::vector<MeasurementPackage> packages(n);
+    double px = 0, py = 0, yaw = 0;
+    const double v = 5.0, dt = 0.05;
+    for (long i = 0; i < n; ++i) {
+        const double yaw_rate = 0.4 * sin(0.02 * i);
+        px += v * cos(yaw) * dt;
+        py += v * sin(yaw) * dt;
+        yaw += yaw_rate * dt;
+        // keep the target within a few hundred metres of the sensor
+        const double x = fmod(px, 400.0) + 10.0, y = fmod(py, 400.0) + 10.0;
+        MeasurementPackage &m = packages[i];
+        m.timestamp_ = 1477010443000000LL + 50000LL * i;
+        if (i % 2 == 0) {
+            m.sensor_type_ = MeasurementPackage::LASER;
+            m.raw_measurements_ = Eigen::VectorXd(2);
+            m.raw_measurements_ << x, y;
+        } else {
+            const double rho = sqrt(x * x + y * y);
+            m.sensor_type_ = MeasurementPackage::RADAR;
+            m.raw_measurements_ = Eigen::VectorXd(3);
+            m.raw_measurements_ << rho, atan2(y, x), v * (x * cos(yaw) + y * sin(yaw)) / rho;
+        }
+    }
+    return packages;
+}
+
+void Report(const char *label, std::vector<double> &ns) {
+    double sum = 0;
+    for (size_t i = 0; i < ns.size(); ++i)
+        sum += ns[i];
+    std::sort(ns.begin(), ns.end());
+    std::cout << std::left << std::setw(12) << label << std::right << std::fixed << std::setprecision(0)
+              << "mean " << std::setw(7) << sum / ns.size() << " ns   p50 " << std::setw(7)
+              << ns[ns.size() / 2] << " ns   p99 " << std::setw(7) << ns[ns.size() * 99 / 100] << " ns"
+              << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long n = BenchIterations(argc, argv, 200000);
+    const std::vector<MeasurementPackage> stream = MakeStream(n);
+
+    // warm up caches and the branch predictor on a separate filter
+    UKF warm;
+    for (long i = 0; i < std::min(n, 10000L); ++i)
+        warm.ProcessMeasurement(stream[i]);
+
+    UKF ukf;
+    std::vector<double> all, lidar, radar;
+    all.reserve(n);
+    lidar.reserve(n / 2 + 1);
+    radar.reserve(n / 2 + 1);
+    BenchTimer total;
+    for (long i = 0; i < n; ++i) {
+        BenchTimer timer;
+        ukf.ProcessMeasurement(stream[i]);
+        const double ns = timer.Seconds() * 1e9;
+        all.push_back(ns);
+        (stream[i].sensor_type_ == MeasurementPackage::LASER ? lidar : radar).push_back(ns);
+    }
+    const double seconds = total.Seconds();
+
+    Eigen::VectorXd state(4);
+    ukf.getState(state);
+    BenchKeep(state);
+
+    BenchReport("UKF::ProcessMeasurement", n, seconds);
+    Report("  lidar", lidar);
+    Report("  radar", radar);
+    Report("  all", all);
+    return 0;
+}
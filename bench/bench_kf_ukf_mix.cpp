@@ -0,0 +1,111 @@
+// UKF lidar updates through the sigma points against the linear shortcut
+// (UKF::setLinearUpdate), over streams with a given share of lidar
+// measurements, the rest radar, 50 ms apart, from a target driving a slow
+// S-curve. Reports the cost per measurement of both (best of three
+// replays, taking turns), the cost per lidar update alone and the largest
+// state difference between the two.
+// Arguments: the number of measurements (default 200000) and the lidar
+// share in percent; without a share, 0, 50, 80, 95 and 100% are run.
+
+#include "bench_util.h"
+#include "ukf.h"
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+
+std::vector<MeasurementPackage> MakeStream(long n, int lidar_percent) {
+    std::vector<MeasurementPackage> packages(n);
+    double px = 0, py = 0, yaw = 0;
+    const double v = 5.0, dt = 0.05;
+    int share = 0;
+    for (long i = 0; i < n; ++i) {
+        const double yaw_rate = 0.4 * sin(0.02 * i);
+        px += v * cos(yaw) * dt;
+        py += v * sin(yaw) * dt;
+        yaw += yaw_rate * dt;
+        const double x = fmod(px, 400.0) + 10.0, y = fmod(py, 400.0) + 10.0;
+        MeasurementPackage &m = packages[i];
+        m.timestamp_ = 1477010443000000LL + 50000LL * i;
+        // lidar_percent of every hundred, spread evenly
+        share += lidar_percent;
+        if (share >= 100) {
+            share -= 100;
+            m.sensor_type_ = MeasurementPackage::LASER;
+            m.raw_measurements_ = Eigen::VectorXd(2);
+            m.raw_measurements_ << x, y;
+        } else {
+            const double rho = sqrt(x * x + y * y);
+            m.sensor_type_ = MeasurementPackage::RADAR;
+            m.raw_measurements_ = Eigen::VectorXd(3);
+            m.raw_measurements_ << rho, atan2(y, x), v * (x * cos(yaw) + y * sin(yaw)) / rho;
+        }
+    }
+    return packages;
+}
+
+double Replay(const std::vector<MeasurementPackage> &stream, bool linear, Eigen::Vector4d &state,
+              double &lidar_seconds) {
+    std::unique_ptr<UKF> ukf(new UKF);
+    ukf->setLinearUpdate(MeasurementPackage::LASER, linear);
+    BenchTimer timer;
+    for (size_t i = 0; i < stream.size(); ++i)
+        ukf->ProcessMeasurement(stream[i]);
+    const double seconds = timer.Seconds();
+    Eigen::VectorXd out(4);
+    ukf->getState(out);
+    state = out;
+
+    // the lidar update alone, on the predicted sigma points of the last step
+    UKF &u = *ukf;
+    MeasurementPackage lidar;
+    lidar.sensor_type_ = MeasurementPackage::LASER;
+    lidar.timestamp_ = u.time_us_;
+    lidar.raw_measurements_ = u.x_.head<2>() + Eigen::Vector2d(0.1, -0.1);
+    const UKF::StateVector x = u.x_;
+    const UKF::StateMatrix P = u.P_;
+    const long updates = 2000;
+    BenchTimer update_timer;
+    for (long i = 0; i < updates; ++i) {
+        u.x_ = x;
+        u.P_ = P;
+        u.UpdateLidar(lidar);
+    }
+    lidar_seconds = update_timer.Seconds() / updates;
+    return seconds;
+}
+
+void Run(long n, int lidar_percent) {
+    const std::vector<MeasurementPackage> stream = MakeStream(n, lidar_percent);
+    double sigma_seconds = 1e300, linear_seconds = 1e300, sigma_lidar = 1e300, linear_lidar = 1e300;
+    Eigen::Vector4d sigma_state, linear_state;
+    for (int pass = 0; pass < 3; ++pass) {
+        double lidar;
+        sigma_seconds = std::min(sigma_seconds, Replay(stream, false, sigma_state, lidar));
+        sigma_lidar = std::min(sigma_lidar, lidar);
+        linear_seconds = std::min(linear_seconds, Replay(stream, true, linear_state, lidar));
+        linear_lidar = std::min(linear_lidar, lidar);
+    }
+
+    std::cout << lidar_percent << "% lidar" << std::endl;
+    BenchReport("  sigma point lidar update", n, sigma_seconds);
+    BenchReport("  linear lidar update", n, linear_seconds);
+    std::cout << "  lidar update alone " << std::setprecision(0) << sigma_lidar * 1e9 << " ns -> "
+              << linear_lidar * 1e9 << " ns, final state difference " << std::scientific << std::setprecision(2)
+              << (sigma_state - linear_state).cwiseAbs().maxCoeff() << std::fixed << std::endl;
+}
+
+}
+
+int main(int argc, char *argv[]) {
+    const long n = BenchIterations(argc, argv, 200000);
+    if (argc > 2) {
+        Run(n, std::max(0, std::min(100, atoi(argv[2]))));
+        return 0;
+    }
+    const int shares[] = {0, 50, 80, 95, 100};
+    for (int i = 0; i < 5; ++i)
+        Run(n, shares[i]);
+    return 0;
+}
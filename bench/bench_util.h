@@ -0,0 +1,139 @@
+#ifndef KF_BENCH_UTIL_H
+#define KF_BENCH_UTIL_H
+
+#include "measurement_package.h"
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * Small helpers shared by the benchmark programs in bench/.
+ * Benchmarks are plain executables; pass an iteration count as the first
+ * argument to override the default.
+ */
+class BenchTimer {
+public:
+    BenchTimer() : start_(std::chrono::steady_clock::now()) {}
+
+    void Reset() { start_ = std::chrono::steady_clock::now(); }
+
+    ///* elapsed wall time in seconds since construction or the last Reset()
+    double Seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start_;
+};
+
+/**
+ * Keeps the compiler from discarding a computed value.
+ */
+template <typename T>
+inline void BenchKeep(const T &value) {
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+inline long BenchIterations(int argc, char *argv[], long default_iterations) {
+    if (argc > 1) {
+        long n = atol(argv[1]);
+        if (n > 0)
+            return n;
+    }
+    return default_iterations;
+}
+
+/**
+ * Prints one result row: label, calls per second and nanoseconds per call.
+ */
+inline void BenchReport(const std::string &label, long calls, double seconds) {
+    std::cout << std::left << std::setw(36) << label << std::right
+              << std::setw(14) << std::fixed << std::setprecision(0) << calls / seconds << " /s"
+              << std::setw(10) << std::setprecision(1) << seconds * 1e9 / calls << " ns"
+              << std::endl;
+}
+
+/**
+ * One line of data/data_synthetic.txt: the measurement as the filters read
+ * it (radar in polar form) and the ground truth
+ */
+struct BenchFrame {
+    MeasurementPackage meas;
+    Eigen::Vector4d truth;  // px, py, vx, vy
+};
+
+/**
+ * Reads ../data/data_synthetic.txt, so benchmarks using it run from the
+ * build directory
+ * @return false, with a message on std::cerr, when there is nothing to read
+ */
+inline bool BenchLoadSynthetic(std::vector<BenchFrame> &frames) {
+    const char *path = "../data/data_synthetic.txt";
+    std::ifstream in(path);
+    std::string line;
+    while (getline(in, line)) {
+        std::istringstream iss(line);
+        std::string sensor;
+        long long timestamp;
+        BenchFrame frame;
+        iss >> sensor;
+        if (sensor == "L") {
+            frame.meas.sensor_type_ = MeasurementPackage::LASER;
+            frame.meas.raw_measurements_ = Eigen::VectorXd(2);
+            iss >> frame.meas.raw_measurements_[0] >> frame.meas.raw_measurements_[1];
+        } else if (sensor == "R") {
+            frame.meas.sensor_type_ = MeasurementPackage::RADAR;
+            frame.meas.raw_measurements_ = Eigen::VectorXd(3);
+            iss >> frame.meas.raw_measurements_[0] >> frame.meas.raw_measurements_[1]
+                >> frame.meas.raw_measurements_[2];
+        } else {
+            continue;
+        }
+        iss >> timestamp >> frame.truth[0] >> frame.truth[1] >> frame.truth[2] >> frame.truth[3];
+        frame.meas.timestamp_ = timestamp;
+        frames.push_back(frame);
+    }
+    if (frames.empty()) {
+        std::cerr << "Cannot read " << path << ", run from the build directory" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Time (microseconds) from one copy of a recording to the next when it is
+ * replayed back to back: its length and one 50 ms frame
+ */
+inline double BenchSpan(const std::vector<BenchFrame> &recording) {
+    return recording.back().meas.timestamp_ - recording.front().meas.timestamp_ + 50000;
+}
+
+/**
+ * copies of a recording back to back, keeping the frames for which
+ * keep(frame) is true, in order
+ */
+template <typename Keep>
+std::vector<BenchFrame> BenchScaleUp(const std::vector<BenchFrame> &recording, long copies, Keep keep) {
+    std::vector<BenchFrame> stream;
+    stream.reserve(recording.size() * copies);
+    const double span = BenchSpan(recording);
+    for (long c = 0; c < copies; ++c)
+        for (size_t i = 0; i < recording.size(); ++i) {
+            if (!keep(recording[i]))
+                continue;
+            stream.push_back(recording[i]);
+            stream.back().meas.timestamp_ += c * span;
+        }
+    return stream;
+}
+
+inline std::vector<BenchFrame> BenchScaleUp(const std::vector<BenchFrame> &recording, long copies) {
+    return BenchScaleUp(recording, copies, [](const BenchFrame &) { return true; });
+}
+
+#endif //KF_BENCH_UTIL_H
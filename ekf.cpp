@@ -4,49 +4,19 @@
 
 #include "ekf.h"
 #include <iostream>
-#include <time.h>
-
-Eigen::MatrixXd CalculateJacobian_cv(const Eigen::VectorXd& x_state) {
-	/**
-	TODO:
-	* Calculate a Jacobian here.
-	*/
-	//std::cout << "Jac 1" << std::endl;
-	Eigen::MatrixXd Hj(3, 4);
-	//std::cout << "Jac 2" << std::endl;
-	//recover state parameters
-	float px = x_state(0);
-	float py = x_state(1);
-	float vx = x_state(2);
-	float vy = x_state(3);
-	//std::cout << "Jac 3" << std::endl;
-	//pre-compute a set of terms to avoid repeated calculation
-	float c1 = px*px + py*py;
-	float c2 = sqrt(c1);
-	float c3 = (c1*c2);
-
-	//check division by zero
-	if (fabs(c1) < 0.0001){
-		std::cout << "CalculateJacobian () - Error - Division by Zero" << std::endl;
-		return Hj;
-	}
-
-	//compute the Jacobian matrix
-	Hj << (px / c2), (py / c2), 0, 0,
-		-(py / c1), (px / c1), 0, 0,
-		py*(vx*py - vy*px) / c3, px*(px*vy - py*vx) / c3, px / c2, py / c2;
 
-	return Hj;
-}
 /**
  * Initializes Unscented Kalman filter
  */
 EKF::EKF() {
 	is_initialized_ = false;
 	previous_timestamp_ = 0;
+	radar_skipped_ = 0;
+	transition_cache_ = &CVTransitionCache::Default();
+	noise_ax2_ = kCVNoiseVariance;
+	noise_ay2_ = kCVNoiseVariance;
 
 
-	H_laser_ = Eigen::MatrixXd(2,4);
 	H_laser_ << 1, 0, 0, 0, 
 		0, 1, 0, 0;
 
@@ -55,7 +25,6 @@ EKF::EKF() {
 
 	// Laser measurement noise standard deviation position2 in m
 	float std_laspy_ = 0.15;
-	R_laser_ = Eigen::MatrixXd(2, 2);
     R_laser_ << std_laspx_*std_laspx_, 0,
             0, std_laspy_*std_laspy_;
 
@@ -67,35 +36,30 @@ EKF::EKF() {
 
 	// Radar measurement noise standard deviation radius change in m/s
 	float std_radrhodot_ = 0.3;
-	R_radar_ = Eigen::MatrixXd(3, 3);
 	R_radar_ << std_radrho_*std_radrho_, 0, 0,
             0, std_radphi_*std_radphi_, 0,
 			0, 0, std_radrhodot_*std_radrhodot_;
 	//״̬
-	ekf_.x_ = Eigen::VectorXd(4);
+	ekf_.x_.setZero();
 	//ϵͳ״̬ȷ
-	ekf_.P_ = Eigen::MatrixXd(4, 4);
 	ekf_.P_ << 1, 0, 0, 0,
 		0, 1, 0, 0,
 		0, 0, 1000, 0,
 		0, 0, 0, 1000;
-	ekf_.F_ = Eigen::MatrixXd(4, 4);
 	ekf_.F_ << 1, 0, 1, 0,
 		0, 1, 0, 1,
 		0, 0, 1, 0,
 		0, 0, 0, 1;
-	ekf_.Q_ = Eigen::MatrixXd(4, 4);
+	ekf_.Q_.setZero();
 }
 
 EKF::~EKF() {}
 
 /**
- * @param {MeasurementPackage} meas_package The latest measurement data of
+ * @param {MeasurementView} meas_package The latest measurement data of
  * either radar or laser.
  */
-void EKF::ProcessMeasurement(const MeasurementPackage &meas_package) {
-	clock_t start, finish;
-	start = clock();
+void EKF::ProcessMeasurement(const MeasurementView &meas_package) {
     if (!is_initialized_) {
 		/*
 		 * һβʱʼ״̬
@@ -103,7 +67,6 @@ void EKF::ProcessMeasurement(const MeasurementPackage &meas_package) {
 		 * radarĲҪӼתΪѿϵ
 		 */
         // first measurement
-		ekf_.x_ = Eigen::VectorXd(4);
 		ekf_.x_ << 1, 1, 1, 1;
 
         if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
@@ -125,54 +88,120 @@ void EKF::ProcessMeasurement(const MeasurementPackage &meas_package) {
         }
 		previous_timestamp_ = meas_package.timestamp_;
         is_initialized_ = true;
+		oosm_.Record(meas_package, ekf_.x_, ekf_.P_);
         return;
     }
+	if (oosm_.enabled() && meas_package.timestamp_ < double(previous_timestamp_)) {
+		ProcessLate(meas_package);
+		return;
+	}
+	Step(meas_package);
+	oosm_.Record(meas_package, ekf_.x_, ekf_.P_);
+}
+
+void EKF::Step(const MeasurementView &meas_package) {
 	/*
 	 * ʱ״̬תF_
 	 * ʱsΪλ
 	 * ´Э
 	 */
 	double delta_t = (double(meas_package.timestamp_) - double(previous_timestamp_)) / 1000000.0;
-	float delta_t2 = delta_t*delta_t;
-	float delta_t3 = delta_t2*delta_t;
-	float delta_t4 = delta_t3*delta_t;
-	//F_
-	ekf_.F_(0, 2) = delta_t;
-	ekf_.F_(1, 3) = delta_t;
-	//Q_
-	ekf_.Q_ = Eigen::MatrixXd(4,4);
-	float noise_ax2 = 9.0;
-	float noise_ay2 = 9.0;
-	ekf_.Q_ << delta_t4 / 4 * noise_ax2, 0, delta_t3 / 2 * noise_ax2, 0,
-				0,   delta_t4 / 4 * noise_ay2, 0, delta_t3 / 2 * noise_ay2,
-			   delta_t3 / 2 * noise_ax2, 0, delta_t2*noise_ax2, 0,
-		        0,   delta_t3 / 2 * noise_ay2, 0, delta_t2*noise_ay2;
+	// F_ and Q_ for this interval, from the shared cache when set
+	CVTransitionCache::Entry scratch;
+	const CVTransitionCache::Entry &transition = Transition(delta_t, scratch);
+	ekf_.F_ = transition.F;
+	ekf_.Q_ = transition.Q;
 	//Ԥ
-	ekf_.Predict();
+	ekf_.PredictCV();
 	/*
 	 * 
 	 * ڴѡµĲ
 	 */
     if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
 		//radarĸ
-		ekf_.H_ = CalculateJacobian_cv(ekf_.x_);//״̬ռ䵽ռӳ,ſ˱Ⱦ
-		ekf_.R_ = R_radar_;//
-        ekf_.UpdateEKF(meas_package.raw_measurements_);//radarݲչ˲
+		if (!ekf_.UpdateRadarCV(meas_package.raw_measurements_, R_radar_))//radarݲչ˲
+			++radar_skipped_;
     } else if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
 		//lidarĸ
-		ekf_.H_ = Eigen::MatrixXd(2,4);//״̬ռ䵽ռӳ
-		ekf_.H_ << 1, 0, 0, 0,
-			0, 1, 0, 0;
-		ekf_.R_ = R_laser_;//
-		ekf_.Update(meas_package.raw_measurements_);//lidarݲԿ˲
+		ekf_.Update(meas_package.raw_measurements_, H_laser_, R_laser_);//lidarݲԿ˲
 	}
 	/*
 	 * ɸ£ʱ
 	 */
 	previous_timestamp_ = meas_package.timestamp_;
-	finish = clock();
-	float totaltime = (double)(finish - start) / CLOCKS_PER_SEC;
-	//std::cout << " -------------Current Frame cluster Time:" << totaltime*1000.0 << "ms" << std::endl;
+}
+
+void EKF::ProcessLate(const MeasurementView &meas_package) {
+	History::Plan plan;
+	if (!oosm_.Prepare(meas_package.timestamp_, plan))
+		return;
+	if (!plan.replay) {
+		Retrodict(meas_package);
+		if (oosm_.Insert(meas_package, plan) >= 0)
+			oosm_.Store(oosm_.size() - 1, ekf_.x_, ekf_.P_);
+		return;
+	}
+	// rewind to the last snapshot before the measurement and process
+	// everything after it again in order
+	const History::Entry &start = oosm_.at(plan.from);
+	ekf_.x_ = start.x;
+	ekf_.P_ = start.P;
+	previous_timestamp_ = start.timestamp;
+	oosm_.Insert(meas_package, plan);
+	for (int i = plan.from + 1; i < oosm_.size(); ++i) {
+		Step(oosm_.at(i).meas);
+		oosm_.Store(i, ekf_.x_, ekf_.P_);
+	}
+}
+
+/**
+ * The late measurement z is taken as a measurement of the current state
+ * through the backward transition F(dt), dt < 0: h(F*x) with Jacobian
+ * H*F. The process noise over the lag, Q(dt) = F*Q(|dt|)*F^T, enters as
+ * extra measurement noise H*Q*H^T.
+ */
+void EKF::Retrodict(const MeasurementView &meas_package) {
+	double delta_t = (double(meas_package.timestamp_) - double(previous_timestamp_)) / 1000000.0;
+	// a negative delta_t is never cached; built here rather than through
+	// Lookup() so that it does not count as a miss
+	CVTransitionCache::Entry back;
+	CVTransitionCache::Compute(delta_t, noise_ax2_, noise_ay2_, back);
+	const Eigen::Vector4d x_back = back.F*ekf_.x_;
+
+	if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+		Eigen::Vector3d h;
+		Eigen::Matrix<double, 3, 4> Hj;
+		if (!kf_radar::MeasurementCV(x_back, h, Hj)) {
+			++radar_skipped_;
+			return;
+		}
+		Eigen::Vector3d y = meas_package.raw_measurements_;
+		y -= h;
+		while (y(1) > M_PI)
+			y(1) -= DoublePI;
+		while (y(1) < -M_PI)
+			y(1) += DoublePI;
+		const Eigen::Matrix<double, 3, 4> H = Hj*back.F;
+		const Eigen::Matrix3d R = R_radar_ + Hj*back.Q*Hj.transpose();
+		ekf_.KalmanFilter(y, H, R);
+	} else if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+		const Eigen::Vector2d y = meas_package.raw_measurements_ - H_laser_*x_back;
+		const Eigen::Matrix<double, 2, 4> H = H_laser_*back.F;
+		const Eigen::Matrix2d R = R_laser_ + H_laser_*back.Q*H_laser_.transpose();
+		ekf_.KalmanFilter(y, H, R);
+	}
+}
+
+const CVTransitionCache::Entry &EKF::Transition(double delta_t, CVTransitionCache::Entry &scratch) {
+	if (transition_cache_)
+		return transition_cache_->Lookup(delta_t, scratch);
+	CVTransitionCache::Compute(delta_t, noise_ax2_, noise_ay2_, scratch);
+	return scratch;
+}
+
+void EKF::setTransitionCache(CVTransitionCache *cache)
+{
+	transition_cache_ = cache;
 }
 
 void EKF::getState(Eigen::VectorXd& x)
@@ -7,7 +7,9 @@
 #include <vector>
 #include <string>
 #include <fstream>
-#include "kf.h"
+#include "kf_fixed.h"
+#include "kf_transition_cache.h"
+#include "kf_oosm.h"
 
 class EKF {
 public:
@@ -25,22 +27,67 @@ public:
      * ProcessMeasurement
      * @param meas_package The latest measurement data of either radar or laser
      */
-    void ProcessMeasurement(const MeasurementPackage &meas_package);
+    void ProcessMeasurement(const MeasurementView &meas_package);
 
 	//˲
-	KF ekf_;
+	KF_FIXED<4> ekf_;
 	void getState(Eigen::VectorXd& x);
+
+	/**
+	* Sets the cache F_ and Q_ are taken from (CVTransitionCache::Default()
+	* unless changed); it must use this filter's noise, kCVNoiseVariance for
+	* both axes.
+	* nullptr rebuilds them on every measurement.
+	*/
+	void setTransitionCache(CVTransitionCache *cache);
+
+	typedef OosmHistory<Eigen::Vector4d, Eigen::Matrix4d> History;
+
+	/**
+	* Out-of-sequence measurement handling (see OosmHistory); off until
+	* given a depth with oosm().setDepth()
+	*/
+	History &oosm() { return oosm_; }
+
+	///* radar updates skipped because the state was too close to the
+	///* sensor for the bearing Jacobian
+	long radarSkipped() const { return radar_skipped_; }
 private:
+	// predict to meas_package and update with it
+	void Step(const MeasurementView &meas_package);
+	// a measurement older than the current state
+	void ProcessLate(const MeasurementView &meas_package);
+	// update the current state with a late measurement through the
+	// backward transition to its timestamp
+	void Retrodict(const MeasurementView &meas_package);
+	// F and Q over delta_t, from the cache or else built with this
+	// filter's noise
+	const CVTransitionCache::Entry &Transition(double delta_t, CVTransitionCache::Entry &scratch);
+
 	//жǷ񱻳ʼ
 	bool is_initialized_;
 
 	// һʱ
 	long long previous_timestamp_;
 	
-	Eigen::MatrixXd R_laser_;//״
-	Eigen::MatrixXd R_radar_;//ײ״
-	Eigen::MatrixXd H_laser_;//״ӳ
-	Eigen::MatrixXd Hj_;//ײ״ӳӦſ˱Ⱦ
+	Eigen::Matrix2d R_laser_;//״
+	Eigen::Matrix3d R_radar_;//ײ״
+	Eigen::Matrix<double, 2, 4> H_laser_;//״ӳ
+
+	// shared F/Q cache, may be null
+	CVTransitionCache *transition_cache_;
+	// acceleration noise variances, used for retrodiction and when there
+	// is no cache
+	float noise_ax2_;
+	float noise_ay2_;
+
+	// recent posteriors, for late measurements
+	History oosm_;
+
+	long radar_skipped_;
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 
@@ -1,47 +1,56 @@
 #include "ekf_ctrv.h"
+#include "kf_autodiff.h"
+#include "kf_models.h"
 #include <iostream>
 
+namespace {
 
-EKF_CTRV::EKF_CTRV() {
+// sin and cos of one angle in a single call where the C library has one
+inline void SinCos(double a, double *s, double *c)
+{
+#if defined(__GLIBC__)
+	sincos(a, s, c);
+#else
+	*s = sin(a);
+	*c = cos(a);
+#endif
+}
+
+}
+
+
+EKF_CTRV::EKF_CTRV() : EKF_CTRV(ConfigPublisher::Default().Get()) {
+	setConfigSource(&ConfigPublisher::Default());
+}
+
+EKF_CTRV::EKF_CTRV(std::shared_ptr<const FilterConfig> config) : config_(config) {
+	config_source_ = nullptr;
+	config_version_ = 0;
 	is_initialized_ = false;
+	sequential_update_ = false;
+	fused_predict_ = true;
+	dense_predict_ = false;
+	covariance_update_ = kf_update::SYMMETRIC_UPDATE;
+	iterated_max_ = 1;
+	iterated_tolerance_ = 0.01;
+	radar_updates_ = 0;
+	radar_iterations_ = 0;
 	previous_timestamp_ = 0;
 
 
 	H_laser_ = Eigen::MatrixXd(2, 5);
 	H_laser_ << 1.0, 0.0, 0.0, 0.0, 0.0,
 		0.0, 1.0, 0.0, 0.0, 0.0;
-	double std_laspx_ = 0.15;
-	double std_laspy_ = 0.15;
+	// R_laser_, R_radar_ and P_ are set by initial()
 	R_laser_ = Eigen::MatrixXd(2, 2);
-	/*ֵĲȷ*/
-	R_laser_ << std_laspx_*std_laspx_, 0.0,
-		0.0, std_laspy_*std_laspy_;
-
-
-	double std_radrho_ = 0.02;
-	double std_radphi_ = 0.01;
-	double std_radrhodot_ = 0.2;
 	R_radar_ = Eigen::MatrixXd(3, 3);
-	/*ֵĲȷ*/
-	R_radar_ << std_radrho_*std_radrho_, 0.0, 0.0,
-		0.0, std_radphi_*std_radphi_, 0.0,
-		0.0, 0.0, std_radrhodot_*std_radrhodot_;
-
 
 	//״̬
-	x_ = Eigen::VectorXd(5);
-	//ϵͳ״̬ȷ
-	P_ = Eigen::MatrixXd(5, 5);
-	double px = 0.25, py = 0.25, pv = 0.3, ptheta = 0.2, pomiga = 1.0;
-	P_ << px, 0.0, 0.0, 0.0, 0.0,
-		0.0, py, 0.0, 0.0, 0.0,
-		0.0, 0.0, pv, 0.0, 0.0,
-		0.0, 0.0, 0.0, ptheta, 0.0,
-		0.0, 0.0, 0.0, 0.0, pomiga;
+	x_.setZero();
 	initial();
 	/*Ҫ״̬תƾ*/
-	Q_ = Eigen::MatrixXd(5, 5);//״̬Э
-	JA_ = Eigen::MatrixXd(5, 5);//״̬תƾſ˱Ⱦ
+	Q_.setZero();//״̬Э
+	JA_.setIdentity();//״̬תƾſ˱Ⱦ
 	HJ_ = Eigen::MatrixXd(3, 5);//Ԥռ䵽ռſ˱Ⱦ
 	std_a_ = 2.0;
 	std_yawdd_ = 0.3;
@@ -49,85 +58,45 @@ EKF_CTRV::EKF_CTRV() {
 
 EKF_CTRV::~EKF_CTRV() {}
 
+/*R and P from the config*/
 void EKF_CTRV::initial()
 {
-	std::string in_file_name_ = "../config.txt";
-	std::ifstream in_file_(in_file_name_.c_str(), std::ifstream::in);
-	if (!in_file_.is_open()) {
-		std::cerr << "Cannot open input file: " << in_file_name_ << std::endl;
-	}
-	std::string line;
-
-	double std_laspx_ = 0.15;
-	double std_laspy_ = 0.15;
-
-	double std_radrho_ = 0.02;
-	double std_radphi_ = 0.01;
-	double std_radrhodot_ = 0.2;
-
-
-	double px = 0.25, py = 0.25, pv = 0.3, ptheta = 0.2, pomiga = 1.0;
-
-	while (getline(in_file_, line))
-	{
-		std::istringstream iss(line);
-		std::string data_type;
-		iss >> data_type;
-		if (data_type.compare("std_laspx_") == 0) {
-			iss >> std_laspx_;
-			continue;
-		}
-		if (data_type.compare("std_laspy_") == 0) {
-			iss >> std_laspy_;
-			continue;
-		}
-		if (data_type.compare("std_radrho_") == 0) {
-			iss >> std_radrho_;
-			continue;
-		}
-		if (data_type.compare("std_radphi_") == 0) {
-			iss >> std_radphi_;
-			continue;
-		}
-		if (data_type.compare("std_radrhodot_") == 0) {
-			iss >> std_radrhodot_;
-			continue;
-		}
-		if (data_type.compare("px") == 0) {
-			iss >> px;
-			continue;
-		}
-		if (data_type.compare("py") == 0) {
-			iss >> py;
-			continue;
-		}
-		if (data_type.compare("pv") == 0) {
-			iss >> pv;
-			continue;
-		}
-		if (data_type.compare("ptheta") == 0) {
-			iss >> ptheta;
-			continue;
-		}
-		if (data_type.compare("pomiga") == 0) {
-			iss >> pomiga;
-			continue;
-		}
-	}
-
-
+	SetNoise();
+	const FilterConfig::CTRV &ctrv = config_->ctrv;
+	P_ << ctrv.px, 0.0, 0.0, 0.0, 0.0,
+		0.0, ctrv.py, 0.0, 0.0, 0.0,
+		0.0, 0.0, ctrv.pv, 0.0, 0.0,
+		0.0, 0.0, 0.0, ctrv.ptheta, 0.0,
+		0.0, 0.0, 0.0, 0.0, ctrv.pomiga;
+}
+/*R from the config*/
+void EKF_CTRV::SetNoise()
+{
+	const FilterConfig::CTRV &ctrv = config_->ctrv;
 	/*ֵĲȷ*/
-	R_laser_ << std_laspx_*std_laspx_, 0.0,
-		0.0, std_laspy_*std_laspy_;
+	R_laser_ << ctrv.std_laspx*ctrv.std_laspx, 0.0,
+		0.0, ctrv.std_laspy*ctrv.std_laspy;
 	/*ֵĲȷ*/
-	R_radar_ << std_radrho_*std_radrho_, 0.0, 0.0,
-		0.0, std_radphi_*std_radphi_, 0.0,
-		0.0, 0.0, std_radrhodot_*std_radrhodot_;
-	P_ << px, 0.0, 0.0, 0.0, 0.0,
-		0.0, py, 0.0, 0.0, 0.0,
-		0.0, 0.0, pv, 0.0, 0.0,
-		0.0, 0.0, 0.0, ptheta, 0.0,
-		0.0, 0.0, 0.0, 0.0, pomiga;
+	R_radar_ << ctrv.std_radrho*ctrv.std_radrho, 0.0, 0.0,
+		0.0, ctrv.std_radphi*ctrv.std_radphi, 0.0,
+		0.0, 0.0, ctrv.std_radrhodot*ctrv.std_radrhodot;
+}
+void EKF_CTRV::setConfigSource(ConfigPublisher *source)
+{
+	config_source_ = source;
+	if (source) {
+		config_version_ = source->version();
+		ApplyConfig(source->Get());
+	}
+}
+/*switch to a new config: R always, P only before the first measurement*/
+void EKF_CTRV::ApplyConfig(std::shared_ptr<const FilterConfig> config)
+{
+	config_ = config;
+	if (is_initialized_)
+		SetNoise();
+	else
+		initial();
 }
 void EKF_CTRV::StateTransition(double delta_t)
 {
@@ -167,8 +136,6 @@ void EKF_CTRV::ProcessQMatrix(double delta_t)
 	float std_yawdd_2 = std_yawdd_*std_yawdd_;
 	float theta = x_[3];
 	//Q_
-	Q_ = Eigen::MatrixXd(5, 5);
-
 	float q11 = 0.25*delta_t4*std_a_2*cos(theta)*cos(theta);
 	float q12 = 0.25*delta_t4*std_a_2*sin(theta)*cos(theta);
 	float q13 = 0.5*delta_t3*std_a_2*cos(theta);
@@ -207,21 +174,22 @@ void EKF_CTRV::ProcessQMatrix(double delta_t)
 
 void EKF_CTRV::ProcessJAMatrix(double delta_t)
 {
-	float v = x_[2];
-	float theta = x_[3];
-	float omiga = x_[4];
-	JA_ = Eigen::MatrixXd(5, 5);//״̬תƾſ˱Ⱦ
+	// in double: the yaw-rate column is the difference of two nearly equal
+	// terms at small yaw rates, which float loses to cancellation
+	double v = x_[2];
+	double theta = x_[3];
+	double omiga = x_[4];
 
-	float q11, q12, q13, q14, q15,
+	double q11, q12, q13, q14, q15,
 		q21, q22, q23, q24, q25;
 
 	if (abs(omiga) > 0.0001)
 	{
-		float tmpTheta = omiga*delta_t + theta;
-		float v_omiga = v / omiga;
-		float _1_omiga = 1 / omiga;
-		float delta_t_v_omiga = delta_t*v_omiga;
-		float v_omiga2 = v / omiga / omiga;
+		double tmpTheta = omiga*delta_t + theta;
+		double v_omiga = v / omiga;
+		double _1_omiga = 1 / omiga;
+		double delta_t_v_omiga = delta_t*v_omiga;
+		double v_omiga2 = v / omiga / omiga;
 		q11 = 1;
 		q12 = 0;
 		q13 = _1_omiga*(-sin(theta) + sin(tmpTheta));
@@ -272,16 +240,147 @@ void EKF_CTRV::ProcessJAMatrix(double delta_t)
 		q51, q52, q53, q54, q55;
 }
 
+/**
+ * One pass over the CTRV prediction: the state transition, Q_ and JA_ are
+ * written together and every sin/cos pair comes from one SinCos call. The
+ * arithmetic and its intermediates (float for the state and Q_, double
+ * for JA_) are those of StateTransition, ProcessQMatrix and
+ * ProcessJAMatrix, so the results are identical; like
+ * them, Q_ and JA_ are evaluated at the predicted yaw and yaw rate.
+ */
+void EKF_CTRV::FusedTransition(double delta_t)
+{
+	float x = x_[0];
+	float y = x_[1];
+	float v = x_[2];
+	float theta = x_[3];
+	float omiga = x_[4];
+	double sin_theta, cos_theta;
+	SinCos(theta, &sin_theta, &cos_theta);
+
+	// predicted yaw as ProcessQMatrix reads it, and its trig
+	float theta_p;
+	double sin_p, cos_p;
+	bool turning = abs(omiga) > 0.0001;
+	if (turning)
+	{
+		float tmpTheta = omiga*delta_t + theta;
+		double sin_tmp, cos_tmp;
+		SinCos(tmpTheta, &sin_tmp, &cos_tmp);
+		float v_omiga = v / omiga;
+		x_[0] = v_omiga*(sin_tmp - sin_theta) + x;
+		x_[1] = v_omiga*(-cos_tmp + cos_theta) + y;
+		x_[2] = v;
+		x_[3] = control_psi(tmpTheta);
+		x_[4] = omiga;
+		theta_p = x_[3];
+		if (theta_p == tmpTheta) {
+			sin_p = sin_tmp;
+			cos_p = cos_tmp;
+		}
+		else
+			SinCos(theta_p, &sin_p, &cos_p);
+	}
+	else
+	{
+		x_[0] = v*cos_theta*delta_t + x;
+		x_[1] = v*sin_theta*delta_t + y;
+		x_[2] = v;
+		x_[3] = theta;
+		x_[4] = 0.0000001;
+		theta_p = theta;
+		sin_p = sin_theta;
+		cos_p = cos_theta;
+	}
+
+	// Q_, zero outside the entries written here
+	float delta_t2 = delta_t*delta_t;
+	float delta_t3 = delta_t2*delta_t;
+	float delta_t4 = delta_t3*delta_t;
+	float std_a_2 = std_a_*std_a_;
+	float std_yawdd_2 = std_yawdd_*std_yawdd_;
+	double q_pp = 0.25*delta_t4*std_a_2;
+	double q_pv = 0.5*delta_t3*std_a_2;
+	float q11 = q_pp*cos_p*cos_p;
+	float q12 = q_pp*sin_p*cos_p;
+	float q22 = q_pp*sin_p*sin_p;
+	float q13 = q_pv*cos_p;
+	float q23 = q_pv*sin_p;
+	float q33 = delta_t2*std_a_2;
+	float q44 = 0.25*delta_t4*std_yawdd_2;
+	float q45 = 0.5*delta_t3*std_yawdd_2;
+	float q55 = delta_t2*std_yawdd_2;
+	Q_(0, 0) = q11;
+	Q_(0, 1) = Q_(1, 0) = q12;
+	Q_(1, 1) = q22;
+	Q_(0, 2) = Q_(2, 0) = q13;
+	Q_(1, 2) = Q_(2, 1) = q23;
+	Q_(2, 2) = q33;
+	Q_(3, 3) = q44;
+	Q_(3, 4) = Q_(4, 3) = q45;
+	Q_(4, 4) = q55;
+
+	// JA_, identity outside rows 0 and 1 and the (3,4) entry; in double
+	// at the predicted state as stored, like ProcessJAMatrix
+	double theta_j = x_[3];
+	double omiga_j = x_[4];
+	double sin_j = sin_p, cos_j = cos_p;
+	if (theta_j != theta_p)
+		SinCos(theta_j, &sin_j, &cos_j);
+	double q13j, q14j, q15j, q23j, q24j, q25j;
+	if (turning)
+	{
+		double tmpTheta = omiga_j*delta_t + theta_j;
+		double sin_tmp, cos_tmp;
+		SinCos(tmpTheta, &sin_tmp, &cos_tmp);
+		double v_omiga = v / omiga_j;
+		double _1_omiga = 1 / omiga_j;
+		double delta_t_v_omiga = delta_t*v_omiga;
+		double v_omiga2 = v / omiga_j / omiga_j;
+		q13j = _1_omiga*(-sin_j + sin_tmp);
+		q14j = v_omiga*(-cos_j + cos_tmp);
+		q15j = delta_t_v_omiga*cos_tmp - v_omiga2*(-sin_j + sin_tmp);
+		q23j = _1_omiga*(cos_j - cos_tmp);
+		q24j = v_omiga*(-sin_j + sin_tmp);
+		q25j = delta_t_v_omiga*sin_tmp - v_omiga2*(cos_j - cos_tmp);
+	}
+	else
+	{
+		q13j = delta_t*cos_j;
+		q14j = -delta_t*v*sin_j;
+		q15j = 0;
+		q23j = delta_t*sin_j;
+		q24j = delta_t*v*cos_j;
+		q25j = 0;
+	}
+	JA_(0, 2) = q13j;
+	JA_(0, 3) = q14j;
+	JA_(0, 4) = q15j;
+	JA_(1, 2) = q23j;
+	JA_(1, 3) = q24j;
+	JA_(1, 4) = q25j;
+	JA_(3, 4) = delta_t;
+}
+
 void EKF_CTRV::Predict(double delta_t)
 {
-	/*״̬ת*/
-	StateTransition(delta_t);
-	/*Q*/
-	ProcessQMatrix(delta_t);
-	/*JA*/
-	ProcessJAMatrix(delta_t);
+	if (fused_predict_)
+		FusedTransition(delta_t);
+	else {
+		/*״̬ת*/
+		StateTransition(delta_t);
+		/*Q*/
+		ProcessQMatrix(delta_t);
+		/*JA*/
+		ProcessJAMatrix(delta_t);
+	}
 	/*Ԥ*/
-	P_ = JA_*P_*JA_.transpose() + Q_;
+	if (dense_predict_)
+		P_ = JA_*P_*JA_.transpose() + Q_;
+	else {
+		kf_propagate::PropagateCTRV(P_, JA_);
+		P_ += Q_;
+	}
 }
 
 void EKF_CTRV::getState(Eigen::VectorXd& x)
@@ -295,6 +394,55 @@ void EKF_CTRV::getState(Eigen::VectorXd& x)
 	x[4] = theta;
 }
 
+void EKF_CTRV::setSequentialUpdate(bool enable)
+{
+	sequential_update_ = enable;
+}
+
+void EKF_CTRV::setFusedPredict(bool enable)
+{
+	fused_predict_ = enable;
+}
+
+void EKF_CTRV::setDensePredict(bool enable)
+{
+	dense_predict_ = enable;
+}
+
+void EKF_CTRV::setCovarianceUpdate(kf_update::CovarianceUpdate form)
+{
+	covariance_update_ = form;
+}
+
+void EKF_CTRV::setIteratedUpdate(int max_iterations, double tolerance)
+{
+	iterated_max_ = max_iterations < 1 ? 1 : max_iterations;
+	iterated_tolerance_ = tolerance;
+}
+
+void EKF_CTRV::UpdateCovariance(const Eigen::MatrixXd &K, const Eigen::MatrixXd &H, const Eigen::MatrixXd &S)
+{
+	if (covariance_update_ == kf_update::SYMMETRIC_UPDATE) {
+		Eigen::MatrixXd KS(K.rows(), K.cols());
+		kf_update::SymmetricUpdate(P_, K, S, KS);
+	}
+	else if (covariance_update_ == kf_update::JOSEPH_UPDATE) {
+		Eigen::Matrix<double, 5, 5> A, AP;
+		Eigen::MatrixXd KR(K.rows(), K.cols());
+		kf_update::JosephUpdate(P_, K, H, R_, A, AP, KR);
+	}
+	else {
+		long x_size = x_.size();
+		Eigen::MatrixXd I = Eigen::MatrixXd::Identity(x_size, x_size);
+		P_ = (I - K*H)*P_;
+	}
+}
+
+void EKF_CTRV::getCovariance(Eigen::MatrixXd& P)
+{
+	P = P_;
+}
+
 double EKF_CTRV::control_psi(double phi)
 {
 	while ((phi > M_PI) || (phi < -M_PI))
@@ -307,86 +455,132 @@ double EKF_CTRV::control_psi(double phi)
 	return phi;
 }
 
-void EKF_CTRV::Update(const Eigen::VectorXd &z)
+void EKF_CTRV::Update(const Eigen::Ref<const Eigen::VectorXd> &z)
 {
 	//ڿ״̬и
+	if (sequential_update_ && kf_update::IsDiagonal(R_)) {
+		Eigen::VectorXd y = z - H_*x_;
+		kf_update::SequentialUpdate(x_, P_, y, H_, R_.diagonal());
+		x_[3] = control_psi(x_[3]);
+		return;
+	}
 	Eigen::MatrixXd HT = H_.transpose();
 	Eigen::MatrixXd S = H_*P_*HT + R_;
-	Eigen::MatrixXd Si = S.inverse();
 	Eigen::MatrixXd PHT = P_*HT;
-	Eigen::MatrixXd K = PHT*Si;
+	Eigen::MatrixXd K(PHT.rows(), PHT.cols());
+	if (!kf_update::SolveGain(S, PHT, K))
+		return;
 
 	Eigen::VectorXd z_pred = H_*x_;//״̬ռ䵽ռת
 	Eigen::VectorXd y = z - z_pred;//ȡֵ״ֵ̬֮Ĳ
 	//״̬
 	x_ = x_ + K*y;
 	x_[3] = control_psi(x_[3]);
-	long x_size = x_.size();
-	Eigen::MatrixXd I = Eigen::MatrixXd::Identity(x_size, x_size);
-	P_ = (I - K*H_)*P_;
+	UpdateCovariance(K, H_, S);
 }
 Eigen::VectorXd EKF_CTRV::ProcessHJMatrix()
 {
-	Eigen::VectorXd hx = Eigen::VectorXd(3);
-	HJ_ = Eigen::MatrixXd(3, 5);//Ԥռ䵽ռſ˱Ⱦ
-	double x = x_[0];
-	double y = x_[1];
-	double v = x_[2];
-	double theta = x_[3];// control_psi(x_[3]);
-	double x2y2 = (x*x + y*y);
-	double sqrt_x2y2 = (sqrt(x2y2));
-	double sqrt23_x2y2 = pow(x2y2, 3.0/2.0);
-	double vxvy = v*x*cos(theta) + v*y*sin(theta);
-	//------------------------------------------
-	double q11 = x / sqrt_x2y2;
-	double q12 = y / sqrt_x2y2;
-	double q13 = 0.0;
-	double q14 = 0.0;
-	double q15 = 0.0;
-	//------------------------------------------
-	double q21 = -y / x2y2;
-	double q22 = x / x2y2;
-	double q23 = 0.0;
-	double q24 = 0.0;
-	double q25 = 0.0;
-	//------------------------------------------
-	double q31 = v*cos(theta) / sqrt_x2y2 - x*vxvy / sqrt23_x2y2;
-	double q32 = v*sin(theta) / sqrt_x2y2 - y*vxvy / sqrt23_x2y2;
-	double q33 = (x*cos(theta) + y*sin(theta)) / sqrt_x2y2;
-	double q34 = (-x*v*sin(theta) + y*v*cos(theta)) / sqrt_x2y2;
-	double q35 = 0.0;
-	//------------------------------------------
-	HJ_ << q11, q12, q13, q14, q15,
-		q21, q22, q23, q24, q25,
-		q31, q32, q33, q34, q35;
-	hx << sqrt_x2y2, atan2(y,x), (v*x*cos(theta) + v*y*sin(theta)) / sqrt_x2y2;
+	Eigen::Vector3d hx;
+	Eigen::Matrix<double, 3, 5> HJ;
+	kf_autodiff::Jacobian(kf_models::CTRVRadar(), x_, hx, HJ);
+	HJ_ = HJ;
 	return hx;
 }
-void EKF_CTRV::UpdateEKF(const Eigen::VectorXd &z)
+void EKF_CTRV::UpdateEKF(const Eigen::Ref<const Eigen::VectorXd> &z)
 {
+	++radar_updates_;
+	if (iterated_max_ > 1) {
+		UpdateIterated(z);
+		return;
+	}
+	++radar_iterations_;
 	Eigen::VectorXd z_pred = ProcessHJMatrix();//״̬ռ䵽ռת
 	if (z_pred[0] < 0.0001)//# if rho is 0
 		z_pred[2] = 0.0;
 	z_pred[1] = control_psi(z_pred[1]);
 	Eigen::VectorXd y = z - z_pred;//ȡֵ״ֵ̬֮Ĳ
 	y[1] = control_psi(y[1]);
+	UpdateInnovation(y, HJ_);
+}
+
+/**
+ * Iterated EKF (Gauss-Newton on the MAP estimate): h and H are taken at the
+ * current iterate x_i by one pass over kf_models::CTRVRadar and the update
+ * restarts from the prediction each time,
+ *   x_i+1 = x_pred + K_i*(z - h(x_i) - H_i*(x_pred - x_i)).
+ * The first iteration is the plain EKF update. P_ is updated once, with
+ * the gain of the last iteration.
+ */
+void EKF_CTRV::UpdateIterated(const Eigen::Ref<const Eigen::VectorXd> &z)
+{
+	const Eigen::Matrix<double, 5, 1> x_pred = x_;
+	const Eigen::Matrix3d R = R_;
+	Eigen::Matrix<double, 5, 1> x_i = x_;
+	Eigen::Vector3d h, y;
+	// the linearisation of the last accepted iteration, and of the current one
+	Eigen::Matrix<double, 3, 5> H, H_i;
+	Eigen::Matrix<double, 5, 3> PHT, K, K_i;
+	Eigen::Matrix3d S, S_i;
+	// steps are measured against the prior covariance, so that the
+	// tolerance means the same for metres, m/s and radians
+	const Eigen::LDLT<Eigen::Matrix<double, 5, 5> > prior(P_);
+	for (int i = 0; i < iterated_max_; ++i) {
+		kf_autodiff::Jacobian(kf_models::CTRVRadar(), x_i, h, H_i);
+		if (h[0] < 0.0001)
+			h[2] = 0.0;
+		y = z - h;
+		y[1] = control_psi(y[1]);
+		y -= H_i*(x_pred - x_i);
+		PHT = P_*H_i.transpose();
+		S_i = H_i*PHT + R;
+		if (!kf_update::SolveGain(S_i, PHT, K_i)) {
+			// keep the last iterate that had a gain, if any
+			if (i == 0)
+				return;
+			break;
+		}
+		++radar_iterations_;
+		H = H_i;
+		K = K_i;
+		S = S_i;
+		const Eigen::Matrix<double, 5, 1> x_next = x_pred + K*y;
+		const Eigen::Matrix<double, 5, 1> dx = x_next - x_i;
+		const double step = sqrt(dx.dot(prior.solve(dx)));
+		x_i = x_next;
+		if (step < iterated_tolerance_)
+			break;
+	}
+	x_ = x_i;
+	x_[3] = control_psi(x_[3]);
+	UpdateCovariance(K, H, S);
+}
+
+void EKF_CTRV::UpdateInnovation(const Eigen::VectorXd &y, const Eigen::MatrixXd &H)
+{
+	if (sequential_update_ && kf_update::IsDiagonal(R_)) {
+		kf_update::SequentialUpdate(x_, P_, y, H, R_.diagonal());
+		x_[3] = control_psi(x_[3]);
+		return;
+	}
 	//ڿ״̬и
-	Eigen::MatrixXd HJ_T = HJ_.transpose();
-	Eigen::MatrixXd S = HJ_*P_*HJ_T + R_;
-	Eigen::MatrixXd Si = S.inverse();
-	Eigen::MatrixXd PHT = P_*HJ_T;
-	Eigen::MatrixXd K = PHT*Si;
+	Eigen::MatrixXd HT = H.transpose();
+	Eigen::MatrixXd S = H*P_*HT + R_;
+	Eigen::MatrixXd PHT = P_*HT;
+	Eigen::MatrixXd K(PHT.rows(), PHT.cols());
+	if (!kf_update::SolveGain(S, PHT, K))
+		return;
 	//״̬
 	x_ = x_ + K*y;
 	x_[3] = control_psi(x_[3]);
-	long x_size = x_.size();
-	Eigen::MatrixXd I = Eigen::MatrixXd::Identity(x_size, x_size);
-	P_ = (I - K*HJ_)*P_;
+	UpdateCovariance(K, H, S);
 }
 
-void EKF_CTRV::ProcessMeasurement(const MeasurementPackage &meas_package) {
-	clock_t start, finish;
-	start = clock();
+void EKF_CTRV::ProcessMeasurement(const MeasurementView &meas_package) {
+	// pick up a config published since the last measurement
+	if (config_source_ && config_source_->version() != config_version_) {
+		config_version_ = config_source_->version();
+		ApplyConfig(config_source_->Get());
+	}
 	if (!is_initialized_)
 	{
 		/*
@@ -394,7 +588,6 @@ void EKF_CTRV::ProcessMeasurement(const MeasurementPackage &meas_package) {
 		* radarĲҪӼתΪѿϵ
 		*/
 		// first measurement
-		x_ = Eigen::VectorXd(5);
 		x_ << 0.0, 0.0, 0.0, 0.0, 0.0;
 
 		if (meas_package.sensor_type_ == MeasurementPackage::LASER)
@@ -418,8 +611,18 @@ void EKF_CTRV::ProcessMeasurement(const MeasurementPackage &meas_package) {
 		}
 		previous_timestamp_ = meas_package.timestamp_;
 		is_initialized_ = true;
+		oosm_.Record(meas_package, x_, P_);
+		return;
+	}
+	if (oosm_.enabled() && meas_package.timestamp_ < double(previous_timestamp_)) {
+		ProcessLate(meas_package);
 		return;
 	}
+	Step(meas_package);
+	oosm_.Record(meas_package, x_, P_);
+}
+
+void EKF_CTRV::Step(const MeasurementView &meas_package) {
 	/*
 	* ʱ״̬תF_
 	* ʱsΪλ
@@ -450,8 +653,62 @@ void EKF_CTRV::ProcessMeasurement(const MeasurementPackage &meas_package) {
 	* ɸ£ʱ
 	*/
 	previous_timestamp_ = meas_package.timestamp_;
-	finish = clock();
-	double totaltime = (double)(finish - start) / CLOCKS_PER_SEC;
-	//std::cout <<"ºĽ"<< x_[3]/M_PI*180.0 << std::endl;
-	//std::cout << " -------------Current Frame cluster Time:" << totaltime*1000.0 << "ms" << std::endl;
-}
\ No newline at end of file
+}
+
+void EKF_CTRV::ProcessLate(const MeasurementView &meas_package)
+{
+	History::Plan plan;
+	if (!oosm_.Prepare(meas_package.timestamp_, plan))
+		return;
+	if (!plan.replay) {
+		Retrodict(meas_package);
+		if (oosm_.Insert(meas_package, plan) >= 0)
+			oosm_.Store(oosm_.size() - 1, x_, P_);
+		return;
+	}
+	// rewind to the last snapshot before the measurement and process
+	// everything after it again in order
+	const History::Entry &start = oosm_.at(plan.from);
+	x_ = start.x;
+	P_ = start.P;
+	previous_timestamp_ = start.timestamp;
+	oosm_.Insert(meas_package, plan);
+	for (int i = plan.from + 1; i < oosm_.size(); ++i) {
+		Step(oosm_.at(i).meas);
+		oosm_.Store(i, x_, P_);
+	}
+}
+
+/*the late measurement is taken as a measurement of the current state through
+* the CTRV transition run backwards (dt < 0): h(f(x)) with Jacobian H*JA, and
+* the process noise over the lag added to R*/
+void EKF_CTRV::Retrodict(const MeasurementView &meas_package)
+{
+	double delta_t = double(meas_package.timestamp_) - double(previous_timestamp_);
+	const Eigen::Matrix<double, 5, 1> x = x_;
+	// the state updated is x, so the backward Jacobian is taken at x, not
+	// at the back-predicted state FusedTransition leaves in JA_
+	ProcessJAMatrix(delta_t);
+	const Eigen::Matrix<double, 5, 5> F = JA_;
+	FusedTransition(delta_t);
+	Eigen::VectorXd y;
+	Eigen::MatrixXd H;
+	if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+		Eigen::VectorXd z_pred = ProcessHJMatrix();
+		if (z_pred[0] < 0.0001)
+			z_pred[2] = 0.0;
+		z_pred[1] = control_psi(z_pred[1]);
+		y = meas_package.raw_measurements_ - z_pred;
+		y[1] = control_psi(y[1]);
+		H = HJ_*F;
+		R_ = R_radar_ + HJ_*Q_*HJ_.transpose();
+	}
+	else if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
+		y = meas_package.raw_measurements_ - H_laser_*x_;
+		H = H_laser_*F;
+		R_ = R_laser_ + H_laser_*Q_*H_laser_.transpose();
+	}
+	x_ = x;
+	if (H.size())
+		UpdateInnovation(y, H);
+}
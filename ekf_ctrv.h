@@ -4,6 +4,10 @@
 
 #include "measurement_package.h"
 #include "Eigen/Dense"
+#include "kf_update.h"
+#include "kf_propagate.h"
+#include "kf_config.h"
+#include "kf_oosm.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -22,46 +26,133 @@ public:
 
 	EKF_CTRV();
 
+	/*R and the initial P from config, fixed, instead of following
+	* ConfigPublisher::Default()*/
+	explicit EKF_CTRV(std::shared_ptr<const FilterConfig> config);
+
 	virtual ~EKF_CTRV();
 	void initial();
 
-	void ProcessMeasurement(const MeasurementPackage &meas_package);
+	void ProcessMeasurement(const MeasurementView &meas_package);
 
 	/*״̬תƺ*/
 	void StateTransition(double delta_t);
 	/*Э*/
 	void ProcessQMatrix(double delta_t);
-	/*״̬תƾſ˱Ⱦ*/
+	/*״̬תƾſ˱Ⱦ. Hand-written, in double so that
+	* the yaw-rate column survives small yaw rates; kf_autodiff would cost
+	* about twice as much (bench_kf_autodiff)*/
 	void ProcessJAMatrix(double delta_t);
+	/*StateTransition, ProcessQMatrix and ProcessJAMatrix in one pass,
+	* with each sin/cos pair evaluated once*/
+	void FusedTransition(double delta_t);
 
-	/*ײ״ӳӦſ˱Ⱦ*/
+	/*ײ״ӳӦſ˱Ⱦ, by automatic differentiation of
+	* kf_models::CTRVRadar*/
 	Eigen::VectorXd ProcessHJMatrix();
 
-	void Update(const Eigen::VectorXd &z);
+	void Update(const Eigen::Ref<const Eigen::VectorXd> &z);
 
 
-	void UpdateEKF(const Eigen::VectorXd &z);
+	void UpdateEKF(const Eigen::Ref<const Eigen::VectorXd> &z);
 	void Predict(double delta_t);
 	void getState(Eigen::VectorXd& x);
 	double control_psi(double psi);
+	/*for a diagonal R, apply measurement components one at a time*/
+	void setSequentialUpdate(bool enable);
+	/*use FusedTransition in Predict (default) instead of the three separate steps*/
+	void setFusedPredict(bool enable);
+	/*propagate P_ with the dense JA_*P_*JA_^T instead of the block kernel*/
+	void setDensePredict(bool enable);
+	/*form of the covariance update, see kf_update::CovarianceUpdate*/
+	void setCovarianceUpdate(kf_update::CovarianceUpdate form);
+	/*iterated EKF for radar: relinearise h about the updated state up to
+	* max_iterations times, stopping early once an iteration moves the state
+	* by less than tolerance prior standard deviations (the Mahalanobis
+	* length sqrt(dx^T P^-1 dx) of the step); 1, the default, is the single
+	* linearisation of the plain EKF. Iterated updates use the batch gain
+	* even with setSequentialUpdate*/
+	void setIteratedUpdate(int max_iterations, double tolerance);
+	/*radar updates made, and the linearisations they took in total: the
+	* average iterations per update is radarIterations() / radarUpdates()*/
+	long radarUpdates() const { return radar_updates_; }
+	long radarIterations() const { return radar_iterations_; }
+	void getCovariance(Eigen::MatrixXd& P);
+	/*follow the configs published by source (ConfigPublisher::Default() unless
+	* changed): picked up at the next measurement, R right away and the initial
+	* P if not yet initialised; nullptr keeps the current config*/
+	void setConfigSource(ConfigPublisher *source);
+
+	typedef OosmHistory<Eigen::Matrix<double, 5, 1>, Eigen::Matrix<double, 5, 5> > History;
+	/*out-of-sequence measurement handling (see OosmHistory); off until given
+	* a depth with oosm().setDepth()*/
+	History &oosm() { return oosm_; }
 private:
+	// predict to meas_package and update with it
+	void Step(const MeasurementView &meas_package);
+	// a measurement older than the current state
+	void ProcessLate(const MeasurementView &meas_package);
+	// update the current state with a late measurement through the
+	// backward transition to its timestamp
+	void Retrodict(const MeasurementView &meas_package);
+	// x_/P_ update from the innovation y of a measurement with Jacobian H
+	// and noise R_
+	void UpdateInnovation(const Eigen::VectorXd &y, const Eigen::MatrixXd &H);
+	// iterated EKF radar update, R_ already set
+	void UpdateIterated(const Eigen::Ref<const Eigen::VectorXd> &z);
+
+	// recent posteriors, for late measurements
+	History oosm_;
+
 	//жǷ񱻳ʼ
 	bool is_initialized_;
 
+	// sequential scalar updates for diagonal R
+	bool sequential_update_;
+
+	// predict with FusedTransition
+	bool fused_predict_;
+
+	// dense covariance propagation
+	bool dense_predict_;
+
+	// covariance update form
+	kf_update::CovarianceUpdate covariance_update_;
+
+	// iterated radar update: linearisations allowed and the state change,
+	// in prior standard deviations, that ends the iteration
+	int iterated_max_;
+	double iterated_tolerance_;
+	long radar_updates_;
+	long radar_iterations_;
+
+	// noise and initial covariance, shared between instances
+	std::shared_ptr<const FilterConfig> config_;
+	// publisher followed for config changes, may be null, and the version
+	// of its config last applied
+	ConfigPublisher *config_source_;
+	unsigned config_version_;
+
+	void SetNoise();
+	void ApplyConfig(std::shared_ptr<const FilterConfig> config);
+
+	// P_ update once the gain K is known
+	void UpdateCovariance(const Eigen::MatrixXd &K, const Eigen::MatrixXd &H, const Eigen::MatrixXd &S);
+
 	// һʱ
 	long long  previous_timestamp_;
 	///* ״̬
-	Eigen::VectorXd x_;
+	Eigen::Matrix<double, 5, 1> x_;
 
 	///* ״̬x_ЭϵͳĲȷ̶
-	Eigen::MatrixXd P_;
+	Eigen::Matrix<double, 5, 5> P_;
 
 	// ״̬תƺ
 	//Eigen::MatrixXd F_;
-	Eigen::MatrixXd JA_;
+	Eigen::Matrix<double, 5, 5> JA_;
 
 	//Э
-	Eigen::MatrixXd Q_;
+	Eigen::Matrix<double, 5, 5> Q_;
 
 	//
 	Eigen::MatrixXd H_;
@@ -77,5 +168,8 @@ private:
 	double std_a_;
 	// ƫǼٶ rad/s^2
 	double std_yawdd_;
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 #endif 
@@ -5,7 +5,9 @@
 /**
  * Initializes Unscented Kalman filter
  */
-KF::KF() {}
+KF::KF() {
+	covariance_update_ = kf_update::SYMMETRIC_UPDATE;
+}
 
 KF::~KF() {}
 
@@ -25,22 +27,33 @@ void KF::Init(Eigen::VectorXd &x_in, Eigen::MatrixXd &P_in, Eigen::MatrixXd &F_i
 void KF::Predict()
 {
 	//״̬Ԥ
-	x_ = F_*x_;
-	Eigen::MatrixXd Ft = F_.transpose();
-	P_ = F_*P_*Ft + Q_;
+	if (Fx_.size() != x_.size()) {
+		Fx_.resize(x_.size());
+		FP_.resize(x_.size(), x_.size());
+	}
+	KFNoMallocScope no_malloc;
+	Fx_.noalias() = F_*x_;
+	x_.swap(Fx_);
+	FP_.noalias() = F_*P_;
+	P_.noalias() = FP_*F_.transpose();
+	P_ += Q_;
 }
 
 void KF::Update(const Eigen::VectorXd& z)
 {
 	//ڿ״̬и
-	Eigen::VectorXd z_pred = H_*x_;//״̬ռ䵽ռת
-	Eigen::VectorXd y = z - z_pred;//ȡֵ״ֵ̬֮Ĳ
-	KF::KalmanFilter(y);
+	Workspace &ws = GetWorkspace(z.size());
+	KFNoMallocScope no_malloc;
+	ws.z_pred.noalias() = H_*x_;//״̬ռ䵽ռת
+	ws.y = z - ws.z_pred;//ȡֵ״ֵ̬֮Ĳ
+	KalmanFilter(ws.y);
 }
 
 void KF::UpdateEKF(const Eigen::VectorXd& z)
 {
 	//չ״̬и
+	Workspace &ws = GetWorkspace(z.size());
+	KFNoMallocScope no_malloc;
 	float px = x_[0];
 	float py = x_[1];
 	float vx = x_[2];
@@ -54,10 +67,10 @@ void KF::UpdateEKF(const Eigen::VectorXd& z)
 		rho = 0.000001;
 	phi = atan2(py,px);
 	rho_dot = (px*vx + py*vy) / rho;
-	Eigen::VectorXd z_pred = Eigen::VectorXd(3);
-	z_pred << rho, phi, rho_dot;
+	ws.z_pred << rho, phi, rho_dot;
 
-	Eigen::VectorXd y = z - z_pred;
+	Eigen::VectorXd &y = ws.y;
+	y = z - ws.z_pred;
 	//Ƕȹһ-УС
 	while (y(1)>M_PI)
 		y(1) -= DoublePI;
@@ -68,20 +81,46 @@ void KF::UpdateEKF(const Eigen::VectorXd& z)
 
 void KF::KalmanFilter(const Eigen::VectorXd& y)
 {
-	Eigen::MatrixXd HT = H_.transpose();
-	Eigen::MatrixXd S = H_*P_*HT + R_;
-	Eigen::MatrixXd Si = S.inverse();
-	Eigen::MatrixXd PHT = P_*HT;
-	Eigen::MatrixXd K = PHT*Si;
+	Workspace &ws = GetWorkspace(y.size());
+	KFNoMallocScope no_malloc;
+	ws.PHT.noalias() = P_*H_.transpose();
+	ws.S = R_;
+	ws.S.noalias() += H_*ws.PHT;
+	if (!kf_update::SolveGain(ws.S, ws.PHT, ws.K, &ws.llt, &ws.ldlt))
+		return;
 
 	//״̬
-	x_ = x_ + K*y;
-	long x_size = x_.size();
-	Eigen::MatrixXd I = Eigen::MatrixXd::Identity(x_size, x_size);
-	P_ = (I - K*H_)*P_;
+	x_.noalias() += ws.K*y;
+	if (covariance_update_ == kf_update::SYMMETRIC_UPDATE)
+		kf_update::SymmetricUpdate(P_, ws.K, ws.S, ws.KS);
+	else if (covariance_update_ == kf_update::JOSEPH_UPDATE)
+		kf_update::JosephUpdate(P_, ws.K, H_, R_, ws.A, ws.AP, ws.KR);
+	else {
+		// P = (I - K*H)*P without forming I
+		ws.HP.noalias() = H_*P_;
+		P_.noalias() -= ws.K*ws.HP;
+	}
 }
 
-
-
-
-
+KF::Workspace &KF::GetWorkspace(long n_z)
+{
+	if (workspace_.size() <= (size_t)n_z)
+		workspace_.resize(n_z + 1);
+	Workspace &ws = workspace_[n_z];
+	long x_size = x_.size();
+	if (ws.PHT.rows() != x_size || ws.S.rows() != n_z) {
+		ws.z_pred.resize(n_z);
+		ws.y.resize(n_z);
+		ws.PHT.resize(x_size, n_z);
+		ws.S.resize(n_z, n_z);
+		ws.K.resize(x_size, n_z);
+		ws.HP.resize(n_z, x_size);
+		ws.KS.resize(x_size, n_z);
+		ws.KR.resize(x_size, n_z);
+		ws.A.resize(x_size, x_size);
+		ws.AP.resize(x_size, x_size);
+		ws.llt.compute(Eigen::MatrixXd::Identity(n_z, n_z));
+		ws.ldlt.compute(Eigen::MatrixXd::Identity(n_z, n_z));
+	}
+	return ws;
+}
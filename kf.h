@@ -4,6 +4,8 @@
 
 #include "measurement_package.h"
 #include "Eigen/Dense"
+#include "kf_alloc_guard.h"
+#include "kf_update.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -30,6 +32,9 @@ public:
 	// Э󣬱ʾĲȷȣͨɴṩ
 	Eigen::MatrixXd R_;
 
+	// form of the covariance update, see kf_update::CovarianceUpdate
+	kf_update::CovarianceUpdate covariance_update_;
+
     /**
      * Constructor
      */
@@ -75,6 +80,39 @@ public:
 	* @param y The difference between measurement and predicted state at k+1
 	*/
 	void KalmanFilter(const Eigen::VectorXd &y);
+
+private:
+	/**
+	* Scratch storage for one measurement dimension. Sized on first use, then
+	* reused so that the steady-state predict/update loop never allocates
+	*/
+	struct Workspace {
+		Eigen::VectorXd z_pred;
+		Eigen::VectorXd y;
+		Eigen::MatrixXd PHT;
+		Eigen::MatrixXd S;
+		Eigen::MatrixXd K;
+		Eigen::MatrixXd HP;
+		Eigen::MatrixXd KS;
+		Eigen::MatrixXd KR;
+		Eigen::MatrixXd A;
+		Eigen::MatrixXd AP;
+		Eigen::LLT<Eigen::MatrixXd> llt;
+		Eigen::LDLT<Eigen::MatrixXd> ldlt;
+	};
+
+	/**
+	* Returns the workspace for measurement dimension n_z, sized for the
+	* current state dimension
+	*/
+	Workspace &GetWorkspace(long n_z);
+
+	// predict scratch: F*x and F*P
+	Eigen::VectorXd Fx_;
+	Eigen::MatrixXd FP_;
+
+	// workspaces indexed by measurement dimension
+	std::vector<Workspace> workspace_;
 };
 
 
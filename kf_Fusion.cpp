@@ -1,50 +1,60 @@
 #include "kf_Fusion.h"
 #include <iostream>
-#include <time.h>
 
 /**
  * Initializes  Kalman filter
  */
-KF_FUSION::KF_FUSION() {
+KF_FUSION::KF_FUSION() : KF_FUSION(ConfigPublisher::Default().Get()) {
+	setConfigSource(&ConfigPublisher::Default());
+}
+
+KF_FUSION::KF_FUSION(std::shared_ptr<const FilterConfig> config) : config_(config) {
+	config_source_ = nullptr;
+	config_version_ = 0;
 	is_initialized_ = false;
 	previous_timestamp_ = 0;
+	transition_cache_ = &CVTransitionCache::Default();
+	noise_ax2_ = kCVNoiseVariance;
+	noise_ay2_ = kCVNoiseVariance;
+	steady_state_ = false;
+	steady_state_updates_ = 0;
+	previous_sensor_ = MeasurementPackage::RADAR;
+	previous_dt_ = 0;
 
 
-	H_laser_ = Eigen::MatrixXd(2,4);
 	H_laser_ << 1, 0, 0, 0, 
 		0, 1, 0, 0;
-	H_radar_ = Eigen::MatrixXd(4, 4);
 	H_radar_ << 1, 0, 0, 0,
 		0, 1, 0, 0,
 		0, 0, 1, 0,
 		0, 0, 0, 1;
-	H_laser_radar_ = Eigen::MatrixXd(4, 4);
 	H_laser_radar_ << 1, 0, 0, 0,
 		0, 1, 0, 0,
 		0, 0, 1, 0,
 		0, 0, 0, 1;
 	initial();
-	ekf_.F_ = Eigen::MatrixXd(4, 4);
 	ekf_.F_ << 1, 0, 1, 0,
 		0, 1, 0, 1,
 		0, 0, 1, 0,
 		0, 0, 0, 1;
-	ekf_.Q_ = Eigen::MatrixXd(4, 4);
+	ekf_.Q_.setZero();
 }
 
 KF_FUSION::~KF_FUSION() {}
 
 
-void KF_FUSION::ProcessMeasurement(const MeasurementPackage &meas_package) {
-	clock_t start, finish;
-	start = clock();
+void KF_FUSION::ProcessMeasurement(const MeasurementView &meas_package) {
+	// pick up a config published since the last measurement
+	if (config_source_ && config_source_->version() != config_version_) {
+		config_version_ = config_source_->version();
+		ApplyConfig(config_source_->Get());
+	}
     if (!is_initialized_) {
 		/*
 		 * һβʱʼ״̬
 		 * Э
 		 * radarĲҪӼתΪѿϵ
 		 */
-		ekf_.x_ = Eigen::VectorXd(4);
 		ekf_.x_ << 1, 1, 1, 1;
 
         if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
@@ -53,6 +63,13 @@ void KF_FUSION::ProcessMeasurement(const MeasurementPackage &meas_package) {
 			ekf_.x_[2] = 5;
 			ekf_.x_[3] = 0;
 		}
+		else if (meas_package.raw_measurements_.size() == 6) {
+			// stacked lidar + radar: lidar position, radar velocity
+			ekf_.x_[0] = meas_package.raw_measurements_[0];
+			ekf_.x_[1] = meas_package.raw_measurements_[1];
+			ekf_.x_[2] = meas_package.raw_measurements_[4];
+			ekf_.x_[3] = meas_package.raw_measurements_[5];
+		}
 		else {
 			ekf_.x_[0] = meas_package.raw_measurements_[0];
 			ekf_.x_[1] = meas_package.raw_measurements_[1];
@@ -69,50 +86,109 @@ void KF_FUSION::ProcessMeasurement(const MeasurementPackage &meas_package) {
 	 * ´Э
 	 */
 	double delta_t = (double(meas_package.timestamp_) - double(previous_timestamp_)) / 1000000.0;
-	float delta_t2 = delta_t*delta_t;
-	float delta_t3 = delta_t2*delta_t;
-	float delta_t4 = delta_t3*delta_t;
-	//F_
-	ekf_.F_(0, 2) = delta_t;
-	ekf_.F_(1, 3) = delta_t;
-	//Q_
-	ekf_.Q_ = Eigen::MatrixXd(4,4);
-	float noise_ax2 = 9.0;
-	float noise_ay2 = 9.0;
-	ekf_.Q_ << delta_t4 / 4 * noise_ax2, 0, delta_t3 / 2 * noise_ax2, 0,
-				0,   delta_t4 / 4 * noise_ay2, 0, delta_t3 / 2 * noise_ay2,
-			   delta_t3 / 2 * noise_ax2, 0, delta_t2*noise_ax2, 0,
-		        0,   delta_t3 / 2 * noise_ay2, 0, delta_t2*noise_ay2;
+	if (steady_slot_ >= 0) {
+		if (meas_package.sensor_type_ == MeasurementPackage::LASER && delta_t == laser_gain_dt_[steady_slot_]) {
+			// converged: predict the state and apply the cached gain, P stays
+			// at the steady-state posterior
+			ekf_.x_[0] += delta_t*ekf_.x_[2];
+			ekf_.x_[1] += delta_t*ekf_.x_[3];
+			Eigen::Vector2d y = meas_package.raw_measurements_.head<2>() - H_laser_*ekf_.x_;
+			ekf_.x_ += laser_gains_[steady_slot_].K()*y;
+			++steady_state_updates_;
+			previous_timestamp_ = meas_package.timestamp_;
+			return;
+		}
+		// dt or sensor changed, continue with the full equations from the
+		// steady-state P
+		steady_slot_ = -1;
+	}
+	// F_ and Q_ for this interval, from the shared cache when set
+	CVTransitionCache::Entry scratch;
+	const CVTransitionCache::Entry &transition = Transition(delta_t, scratch);
+	ekf_.F_ = transition.F;
+	ekf_.Q_ = transition.Q;
 	//Ԥ
-	ekf_.Predict();
+	ekf_.PredictCV();
 	/*
 	 * 
 	 * ڴѡµĲ
 	 */
     if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
 		//radarĸ
-		ekf_.H_ = H_radar_;
-		ekf_.R_ = R_radar_;//
-		ekf_.Update(meas_package.raw_measurements_);//radarݲչ˲
+		ekf_.Update(meas_package.raw_measurements_, H_radar_, R_radar_);//radarݲչ˲
     } else if (meas_package.sensor_type_ == MeasurementPackage::LASER) {
 		//lidarĸ
-		ekf_.H_ = H_laser_;
-		ekf_.R_ = R_laser_;//
-		ekf_.Update(meas_package.raw_measurements_);//lidarݲԿ˲
+		ekf_.Update(meas_package.raw_measurements_, H_laser_, R_laser_);//lidarݲԿ˲
 	}
 	else if (meas_package.sensor_type_ == MeasurementPackage::LASER_RADAR) {
-		//lidarĸ
-		ekf_.H_ = H_laser_radar_;
-		ekf_.R_ = R_laser_radar_;//
-		ekf_.Update(meas_package.raw_measurements_);//ĬΪģ
+		if (meas_package.raw_measurements_.size() == 6) {
+			// stacked lidar + cartesian radar (MeasurementGrouper). R is block
+			// diagonal, so the joint 6-element update is exactly the lidar
+			// block update followed by the radar block update, without the
+			// 6x6 solve
+			ekf_.Update(meas_package.raw_measurements_.head<2>(), H_laser_, R_laser_);
+			ekf_.Update(meas_package.raw_measurements_.tail<4>(), H_radar_, R_radar_);
+		}
+		else {
+			//lidarĸ
+			ekf_.Update(meas_package.raw_measurements_, H_laser_radar_, R_laser_radar_);//ĬΪģ
+		}
 	}
 	/*
 	 * ɸ£ʱ
 	 */
+	if (steady_state_ && meas_package.sensor_type_ == MeasurementPackage::LASER)
+		TrySteadyState(delta_t);
+	previous_sensor_ = meas_package.sensor_type_;
+	previous_dt_ = delta_t;
 	previous_timestamp_ = meas_package.timestamp_;
-	finish = clock();
-	float totaltime = (double)(finish - start) / CLOCKS_PER_SEC;
-	//std::cout << " -------------Current Frame cluster Time:" << totaltime*1000.0 << "ms" << std::endl;
+}
+
+const CVTransitionCache::Entry &KF_FUSION::Transition(double delta_t, CVTransitionCache::Entry &scratch) {
+	if (transition_cache_)
+		return transition_cache_->Lookup(delta_t, scratch);
+	CVTransitionCache::Compute(delta_t, noise_ax2_, noise_ay2_, scratch);
+	return scratch;
+}
+
+void KF_FUSION::setTransitionCache(CVTransitionCache *cache)
+{
+	transition_cache_ = cache;
+}
+
+void KF_FUSION::setSteadyState(bool on)
+{
+	steady_state_ = on;
+	steady_slot_ = -1;
+}
+
+/**
+ * Called after a full lidar update: once dt has repeated (so a jittery
+ * stream does not re-solve every frame) looks up or solves the Riccati
+ * equation for dt, and enters the steady-state path once P has converged
+ * to its solution
+ */
+void KF_FUSION::TrySteadyState(double delta_t)
+{
+	// relative distance of P from the steady-state posterior to switch at
+	static const double kConvergedTolerance = 1e-9;
+
+	if (previous_sensor_ != MeasurementPackage::LASER || delta_t != previous_dt_)
+		return;
+	int slot = 0;
+	while (slot < kSteadyStateSlots && laser_gain_dt_[slot] != delta_t)
+		++slot;
+	if (slot == kSteadyStateSlots) {
+		// a failed solve stays in its slot, invalid, until it is replaced
+		slot = next_gain_slot_;
+		next_gain_slot_ = (next_gain_slot_ + 1) % kSteadyStateSlots;
+		laser_gain_dt_[slot] = delta_t;
+		laser_gains_[slot].Solve(ekf_.F_, ekf_.Q_, H_laser_, R_laser_, ekf_.P_);
+	}
+	if (laser_gains_[slot].IsConverged(ekf_.P_, kConvergedTolerance)) {
+		ekf_.P_ = laser_gains_[slot].P();
+		steady_slot_ = slot;
+	}
 }
 
 void KF_FUSION::getState(Eigen::VectorXd& x)
@@ -123,94 +199,68 @@ void KF_FUSION::getState(Eigen::VectorXd& x)
 	x[3] = ekf_.x_[3];
 }
 
+/**
+ * Resets R and P from the config
+ */
 void KF_FUSION::initial()
 {
-	std::string in_file_name_ = "../config.txt";
-	std::ifstream in_file_(in_file_name_.c_str(), std::ifstream::in);
-	if (!in_file_.is_open()) {
-		std::cerr << "Cannot open input file: " << in_file_name_ << std::endl;
-		exit(EXIT_FAILURE);
-	}
-	std::string line;
-	float std_laspx_ = 0.05;
-	float std_laspy_ = 0.05;
-	float std_radpx_ = 0.3;
-	float std_radpy_ = 0.3;
-	float std_vx_ = 1.3;
-	float std_vy_ = 1.3;
-
-	float px_ = 1;
-	float py_ = 1;
-	float pvx_ = 0.5;
-	float pvy_ = 0.5;
-	while (getline(in_file_, line))
-	{
-		std::istringstream iss(line);
-		std::string data_type;
-		iss >> data_type;
-		if (data_type.compare("std_laspx_") == 0) {
-			iss >> std_laspx_;
-			continue;
-		}
-		if (data_type.compare("std_laspy_") == 0) {
-			iss >> std_laspy_;
-			continue;
-		}
-		if (data_type.compare("std_radpx_") == 0) {
-			iss >> std_radpx_;
-			continue;
-		}
-		if (data_type.compare("std_radpy_") == 0) {
-			iss >> std_radpy_;
-			continue;
-		}
-		if (data_type.compare("std_vx_") == 0) {
-			iss >> std_vx_;
-			continue;
-		}
-		if (data_type.compare("std_vy_") == 0) {
-			iss >> std_vy_;
-			continue;
-		}
-		if (data_type.compare("px_") == 0) {
-			iss >> px_;
-			continue;
-		}
-		if (data_type.compare("py_") == 0) {
-			iss >> py_;
-			continue;
-		}
-		if (data_type.compare("pvx_") == 0) {
-			iss >> pvx_;
-			continue;
-		}
-		if (data_type.compare("pvy_") == 0) {
-			iss >> pvy_;
-			continue;
-		}
-	}
-	R_laser_ = Eigen::MatrixXd(2, 2);
-	R_laser_ << std_laspx_*std_laspx_, 0,
-		0, std_laspy_*std_laspy_;
-	R_radar_ = Eigen::MatrixXd(4, 4);
-	R_radar_ << std_radpx_*std_radpx_, 0, 0, 0,
-		0, std_radpy_*std_radpy_, 0, 0,
-		0, 0, std_vx_*std_vx_, 0,
-		0, 0, 0, std_vy_*std_vy_;
-
-	R_laser_radar_ = Eigen::MatrixXd(4, 4);
-	R_laser_radar_ << std_laspx_*std_laspx_, 0, 0, 0,
-		0, std_laspy_*std_laspy_, 0, 0,
-		0, 0, std_vx_*std_vx_, 0,
-		0, 0, 0, std_vx_*std_vx_;
+	SetNoise();
+	const FilterConfig::CV &cv = config_->cv;
 
 	//ϵͳ״̬ȷ
-	ekf_.P_ = Eigen::MatrixXd(4, 4);
-	ekf_.P_ << px_, 0, 0, 0,
-		0, py_, 0, 0,
-		0, 0, pvx_, 0,
-		0, 0, 0, pvy_;
+	ekf_.P_ << cv.px, 0, 0, 0,
+		0, cv.py, 0, 0,
+		0, 0, cv.pvx, 0,
+		0, 0, 0, cv.pvy;
 
 	//״̬
-	ekf_.x_ = Eigen::VectorXd(4);
+	ekf_.x_.setZero();
+}
+
+/**
+ * R from the config; the steady-state gains depend on R_laser_ and are
+ * dropped
+ */
+void KF_FUSION::SetNoise()
+{
+	const FilterConfig::CV &cv = config_->cv;
+	R_laser_ << cv.std_laspx*cv.std_laspx, 0,
+		0, cv.std_laspy*cv.std_laspy;
+	R_radar_ << cv.std_radpx*cv.std_radpx, 0, 0, 0,
+		0, cv.std_radpy*cv.std_radpy, 0, 0,
+		0, 0, cv.std_vx*cv.std_vx, 0,
+		0, 0, 0, cv.std_vy*cv.std_vy;
+
+	R_laser_radar_ << cv.std_laspx*cv.std_laspx, 0, 0, 0,
+		0, cv.std_laspy*cv.std_laspy, 0, 0,
+		0, 0, cv.std_vx*cv.std_vx, 0,
+		0, 0, 0, cv.std_vx*cv.std_vx;
+
+	for (int i = 0; i < kSteadyStateSlots; ++i) {
+		laser_gains_[i].Invalidate();
+		laser_gain_dt_[i] = -1;
+	}
+	next_gain_slot_ = 0;
+	steady_slot_ = -1;
+}
+
+void KF_FUSION::setConfigSource(ConfigPublisher *source)
+{
+	config_source_ = source;
+	if (source) {
+		config_version_ = source->version();
+		ApplyConfig(source->Get());
+	}
+}
+
+/**
+ * Switches to a new config: R always, P only before the first measurement
+ */
+void KF_FUSION::ApplyConfig(std::shared_ptr<const FilterConfig> config)
+{
+	config_ = config;
+	if (is_initialized_)
+		SetNoise();
+	else
+		initial();
 }
@@ -7,7 +7,10 @@
 #include <vector>
 #include <string>
 #include <fstream>
-#include "kf.h"
+#include "kf_fixed.h"
+#include "kf_config.h"
+#include "kf_steady_state.h"
+#include "kf_transition_cache.h"
 
 
 
@@ -18,14 +21,48 @@ public:
 
 	KF_FUSION();
 
+	/**
+	* Takes R and the initial P from config, fixed, instead of following
+	* ConfigPublisher::Default()
+	*/
+	explicit KF_FUSION(std::shared_ptr<const FilterConfig> config);
+
 	virtual ~KF_FUSION();
 
-    void ProcessMeasurement(const MeasurementPackage &meas_package);
+    void ProcessMeasurement(const MeasurementView &meas_package);
 
 	//˲
-	KF ekf_;
+	KF_FIXED<4> ekf_;
 	void getState(Eigen::VectorXd& x);
 	void initial();
+
+	/**
+	* Sets the cache F_ and Q_ are taken from (CVTransitionCache::Default()
+	* unless changed); it must use this filter's noise, kCVNoiseVariance for
+	* both axes.
+	* nullptr rebuilds them on every measurement.
+	*/
+	void setTransitionCache(CVTransitionCache *cache);
+
+	/**
+	* Follows the configs published by source (ConfigPublisher::Default()
+	* unless changed): a new one is picked up at the next measurement, R
+	* right away and the initial P if the filter is not yet initialised.
+	* nullptr keeps the current config.
+	*/
+	void setConfigSource(ConfigPublisher *source);
+
+	/**
+	* Enables the steady-state lidar path (default off). Once consecutive
+	* lidar frames arrive with the same dt and the covariance has converged
+	* to the solution of the Riccati equation for that dt, lidar updates use
+	* the cached gain and leave P at its steady-state value. Any other dt or
+	* sensor falls back to the full predict/update.
+	*/
+	void setSteadyState(bool on);
+
+	///* number of lidar frames handled by the steady-state path
+	long steadyStateUpdates() const { return steady_state_updates_; }
 private:
 	//жǷ񱻳ʼ
 	bool is_initialized_;
@@ -33,12 +70,50 @@ private:
 	// һʱ
 	long long previous_timestamp_;
 	
-	Eigen::MatrixXd R_laser_;//״
-	Eigen::MatrixXd R_radar_;//ײ״
-	Eigen::MatrixXd R_laser_radar_;//ײ״
-	Eigen::MatrixXd H_laser_;//״ӳ
-	Eigen::MatrixXd H_radar_;//ײ״ӳ
-	Eigen::MatrixXd H_laser_radar_;//ײ״ӳ
+	Eigen::Matrix2d R_laser_;//״
+	Eigen::Matrix4d R_radar_;//ײ״
+	Eigen::Matrix4d R_laser_radar_;//ײ״
+	Eigen::Matrix<double, 2, 4> H_laser_;//״ӳ
+	Eigen::Matrix4d H_radar_;//ײ״ӳ
+	Eigen::Matrix4d H_laser_radar_;//ײ״ӳ
+
+	// noise and initial covariance, shared between instances
+	std::shared_ptr<const FilterConfig> config_;
+	// publisher followed for config changes, may be null, and the version
+	// of its config last applied
+	ConfigPublisher *config_source_;
+	unsigned config_version_;
+
+	void SetNoise();
+	void ApplyConfig(std::shared_ptr<const FilterConfig> config);
+
+	// shared F/Q cache, may be null
+	CVTransitionCache *transition_cache_;
+	// acceleration noise variances, used when there is no cache
+	float noise_ax2_;
+	float noise_ay2_;
+	// F and Q over delta_t, from the cache or else built with this
+	// filter's noise
+	const CVTransitionCache::Entry &Transition(double delta_t, CVTransitionCache::Entry &scratch);
+
+	// steady-state lidar gains, one slot per dt (H_laser_, R_laser_ and the
+	// process noise are otherwise fixed), replaced round robin
+	enum { kSteadyStateSlots = 4 };
+	SteadyStateGain<4, 2> laser_gains_[kSteadyStateSlots];
+	double laser_gain_dt_[kSteadyStateSlots];
+	int next_gain_slot_;
+	// slot in use while on the steady-state path, otherwise -1
+	int steady_slot_;
+	bool steady_state_;
+	long steady_state_updates_;
+	// sensor and dt of the previous frame
+	MeasurementPackage::SensorType previous_sensor_;
+	double previous_dt_;
+
+	void TrySteadyState(double delta_t);
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 
@@ -0,0 +1,34 @@
+#ifndef KF_KF_ALLOC_GUARD_H
+#define KF_KF_ALLOC_GUARD_H
+
+#include "Eigen/Core"
+
+/**
+ * Marks a scope of the predict/update hot path that must not touch the heap.
+ *
+ * Debug builds define EIGEN_RUNTIME_NO_MALLOC (see CMakeLists.txt); inside a
+ * KFNoMallocScope any Eigen heap allocation then fails an assertion instead
+ * of silently slowing the filter down. In release builds the scope is empty.
+ */
+class KFNoMallocScope {
+public:
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+	KFNoMallocScope() : previous_(Eigen::internal::is_malloc_allowed()) {
+		Eigen::internal::set_is_malloc_allowed(false);
+	}
+
+	~KFNoMallocScope() {
+		Eigen::internal::set_is_malloc_allowed(previous_);
+	}
+
+private:
+	bool previous_;
+#else
+	KFNoMallocScope() {}
+#endif
+
+	KFNoMallocScope(const KFNoMallocScope &);
+	KFNoMallocScope &operator=(const KFNoMallocScope &);
+};
+
+#endif //KF_KF_ALLOC_GUARD_H
@@ -0,0 +1,228 @@
+#ifndef KF_KF_AUTODIFF_H
+#define KF_KF_AUTODIFF_H
+
+
+#include "Eigen/Dense"
+// <cmath>, not <math.h>: the latter also declares the float overloads of
+// sin, cos and abs globally, which changes the float arithmetic of the
+// files that include this one (EKF_CTRV's separate predict steps)
+#include <cmath>
+
+/**
+ * Forward-mode automatic differentiation for the process and measurement
+ * Jacobians of the motion models.
+ *
+ * A model is a functor with a templated
+ *     template <typename T> void operator()(const T *x, T *y) const;
+ * that writes y = f(x) using the usual arithmetic and sin, cos, sqrt,
+ * atan2 and fabs. Called with T = double it evaluates f; Jacobian() calls
+ * it with T = Dual<Scalar, NX>, a value carrying its NX partial
+ * derivatives in a fixed-size vector, seeded with the unit vectors, and
+ * reads f(x) and the NY x NX Jacobian off the result in one pass.
+ * Everything is fixed-size and inlined, so the derivative arithmetic
+ * compiles to unrolled straight-line code. Comparisons look at the value
+ * only, so a model may branch on its state; each branch is differentiated
+ * as written.
+ */
+namespace kf_autodiff {
+
+/**
+ * A value and its derivatives with respect to N inputs
+ */
+template <typename Scalar, int N>
+struct Dual {
+	Scalar v;
+	Eigen::Matrix<Scalar, N, 1> d;
+
+	Dual() {}
+	// a constant: all derivatives zero
+	Dual(Scalar value) : v(value) {
+		d.setZero();
+	}
+
+	Dual &operator+=(const Dual &b) {
+		v += b.v;
+		d += b.d;
+		return *this;
+	}
+	Dual &operator-=(const Dual &b) {
+		v -= b.v;
+		d -= b.d;
+		return *this;
+	}
+	Dual &operator+=(Scalar b) { v += b; return *this; }
+	Dual &operator-=(Scalar b) { v -= b; return *this; }
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+// value of a plain scalar or a Dual, for code written for both
+inline double Value(double a) { return a; }
+inline float Value(float a) { return a; }
+template <typename Scalar, int N>
+inline Scalar Value(const Dual<Scalar, N> &a) { return a.v; }
+
+/**
+ * r = (value, a.d * da): the chain rule for a function of one argument
+ * with derivative da at a.v
+ */
+template <typename Scalar, int N>
+inline Dual<Scalar, N> Chain(Scalar value, const Dual<Scalar, N> &a, Scalar da) {
+	Dual<Scalar, N> r;
+	r.v = value;
+	r.d = da*a.d;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator-(const Dual<Scalar, N> &a) {
+	return Chain(-a.v, a, Scalar(-1));
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator+(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) {
+	Dual<Scalar, N> r;
+	r.v = a.v + b.v;
+	r.d = a.d + b.d;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator-(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) {
+	Dual<Scalar, N> r;
+	r.v = a.v - b.v;
+	r.d = a.d - b.d;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator*(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) {
+	Dual<Scalar, N> r;
+	r.v = a.v*b.v;
+	r.d = b.v*a.d + a.v*b.d;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator/(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) {
+	const Scalar inv = Scalar(1) / b.v;
+	Dual<Scalar, N> r;
+	r.v = a.v*inv;
+	r.d = (a.d - r.v*b.d)*inv;
+	return r;
+}
+
+// mixed with a constant
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator+(const Dual<Scalar, N> &a, Scalar b) {
+	Dual<Scalar, N> r = a;
+	r.v += b;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator+(Scalar a, const Dual<Scalar, N> &b) {
+	return b + a;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator-(const Dual<Scalar, N> &a, Scalar b) {
+	Dual<Scalar, N> r = a;
+	r.v -= b;
+	return r;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator-(Scalar a, const Dual<Scalar, N> &b) {
+	return Chain(a - b.v, b, Scalar(-1));
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator*(const Dual<Scalar, N> &a, Scalar b) {
+	return Chain(a.v*b, a, b);
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator*(Scalar a, const Dual<Scalar, N> &b) {
+	return Chain(a*b.v, b, a);
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator/(const Dual<Scalar, N> &a, Scalar b) {
+	const Scalar inv = Scalar(1) / b;
+	return Chain(a.v*inv, a, inv);
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> operator/(Scalar a, const Dual<Scalar, N> &b) {
+	const Scalar inv = Scalar(1) / b.v;
+	return Chain(a*inv, b, -a*inv*inv);
+}
+
+// comparisons look at the value
+
+template <typename Scalar, int N>
+inline bool operator<(const Dual<Scalar, N> &a, Scalar b) { return a.v < b; }
+template <typename Scalar, int N>
+inline bool operator>(const Dual<Scalar, N> &a, Scalar b) { return a.v > b; }
+template <typename Scalar, int N>
+inline bool operator<(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) { return a.v < b.v; }
+template <typename Scalar, int N>
+inline bool operator>(const Dual<Scalar, N> &a, const Dual<Scalar, N> &b) { return a.v > b.v; }
+
+// elementary functions
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> sin(const Dual<Scalar, N> &a) {
+	return Chain(Scalar(::sin(a.v)), a, Scalar(::cos(a.v)));
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> cos(const Dual<Scalar, N> &a) {
+	return Chain(Scalar(::cos(a.v)), a, Scalar(-::sin(a.v)));
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> sqrt(const Dual<Scalar, N> &a) {
+	const Scalar s = ::sqrt(a.v);
+	return Chain(s, a, Scalar(0.5) / s);
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> fabs(const Dual<Scalar, N> &a) {
+	return a.v < 0 ? -a : a;
+}
+
+template <typename Scalar, int N>
+inline Dual<Scalar, N> atan2(const Dual<Scalar, N> &y, const Dual<Scalar, N> &x) {
+	// d atan2(y, x) = (x dy - y dx) / (x^2 + y^2)
+	const Scalar inv = Scalar(1) / (x.v*x.v + y.v*y.v);
+	Dual<Scalar, N> r;
+	r.v = ::atan2(y.v, x.v);
+	r.d = (x.v*y.d - y.v*x.d)*inv;
+	return r;
+}
+
+/**
+ * y = f(x) and J = df/dx at x, for a model f as described above
+ */
+template <typename Scalar, int NX, int NY, typename Model>
+inline void Jacobian(const Model &f, const Eigen::Matrix<Scalar, NX, 1> &x,
+	Eigen::Matrix<Scalar, NY, 1> &y, Eigen::Matrix<Scalar, NY, NX> &J) {
+	Dual<Scalar, NX> xd[NX], yd[NY];
+	for (int i = 0; i < NX; ++i) {
+		xd[i].v = x[i];
+		xd[i].d = Eigen::Matrix<Scalar, NX, 1>::Unit(i);
+	}
+	f(xd, yd);
+	for (int r = 0; r < NY; ++r) {
+		y[r] = yd[r].v;
+		J.row(r) = yd[r].d.transpose();
+	}
+}
+
+}
+
+
+#endif //KF_KF_AUTODIFF_H
@@ -0,0 +1,145 @@
+#include "kf_bank.h"
+#include "kf_simd.h"
+
+namespace {
+
+typedef SymPacked<4> Packed;
+
+/**
+ * Predict for the tracks [begin, end) that fill whole lanes of V.
+ * Returns the index of the first track not processed.
+ */
+template <typename V>
+int PredictLanes(std::vector<double> *x, std::vector<double> *P, int begin, int end,
+	double delta_t, double noise_ax2, double noise_ay2) {
+	double dt2 = delta_t*delta_t;
+	double dt3 = dt2*delta_t;
+	double dt4 = dt3*delta_t;
+	const V dt = V::Set(delta_t);
+	const V q_pp_x = V::Set(dt4 / 4 * noise_ax2), q_pv_x = V::Set(dt3 / 2 * noise_ax2), q_vv_x = V::Set(dt2*noise_ax2);
+	const V q_pp_y = V::Set(dt4 / 4 * noise_ay2), q_pv_y = V::Set(dt3 / 2 * noise_ay2), q_vv_y = V::Set(dt2*noise_ay2);
+
+	int i = begin;
+	for (; i + V::Width <= end; i += V::Width) {
+		// x = F*x
+		V vx = V::Load(&x[2][i]);
+		V vy = V::Load(&x[3][i]);
+		(V::Load(&x[0][i]) + dt*vx).Store(&x[0][i]);
+		(V::Load(&x[1][i]) + dt*vy).Store(&x[1][i]);
+
+		// P = F*P*F^T + Q
+		V p[Packed::Size];
+		for (int k = 0; k < Packed::Size; ++k)
+			p[k] = V::Load(&P[k][i]);
+		kf_packed::PropagateCV(p, dt);
+		p[Packed::Index(0, 0)] = p[Packed::Index(0, 0)] + q_pp_x;
+		p[Packed::Index(0, 2)] = p[Packed::Index(0, 2)] + q_pv_x;
+		p[Packed::Index(2, 2)] = p[Packed::Index(2, 2)] + q_vv_x;
+		p[Packed::Index(1, 1)] = p[Packed::Index(1, 1)] + q_pp_y;
+		p[Packed::Index(1, 3)] = p[Packed::Index(1, 3)] + q_pv_y;
+		p[Packed::Index(3, 3)] = p[Packed::Index(3, 3)] + q_vv_y;
+		for (int k = 0; k < Packed::Size; ++k)
+			p[k].Store(&P[k][i]);
+	}
+	return i;
+}
+
+/**
+ * Lidar update (H = [I 0]) for the tracks [begin, end) that fill whole
+ * lanes of V. Returns the index of the first track not processed.
+ */
+template <typename V>
+int UpdateLidarLanes(std::vector<double> *x, std::vector<double> *P, int begin, int end,
+	const double *z_px, const double *z_py, double r_px, double r_py) {
+	const V r0 = V::Set(r_px);
+	const V r1 = V::Set(r_py);
+
+	int i = begin;
+	for (; i + V::Width <= end; i += V::Width) {
+		V s[4], p[Packed::Size];
+		for (int r = 0; r < 4; ++r)
+			s[r] = V::Load(&x[r][i]);
+		for (int k = 0; k < Packed::Size; ++k)
+			p[k] = V::Load(&P[k][i]);
+		// y = z - H*x
+		V y0 = V::Load(&z_px[i]) - s[0];
+		V y1 = V::Load(&z_py[i]) - s[1];
+		kf_packed::UpdatePosition<4>(s, p, y0, y1, r0, r1);
+		for (int r = 0; r < 4; ++r)
+			s[r].Store(&x[r][i]);
+		for (int k = 0; k < Packed::Size; ++k)
+			p[k].Store(&P[k][i]);
+	}
+	return i;
+}
+
+}
+
+KFBank::KFBank() {
+	size_ = 0;
+	// same defaults as KF_FUSION
+	setLidarNoise(0.05, 0.05);
+	setProcessNoise(9.0, 9.0);
+}
+
+KFBank::~KFBank() {}
+
+int KFBank::AddTrack(const Eigen::Vector4d &x, const Eigen::Matrix4d &P)
+{
+	for (int r = 0; r < 4; ++r)
+		x_[r].push_back(x[r]);
+	const Packed packed(P);
+	for (int k = 0; k < Packed::Size; ++k)
+		P_[k].push_back(packed.data()[k]);
+	return size_++;
+}
+
+int KFBank::size() const
+{
+	return size_;
+}
+
+void KFBank::Predict(double delta_t)
+{
+	int i = PredictLanes<kf_simd::LaneWide>(x_, P_, 0, size_, delta_t, noise_ax2_, noise_ay2_);
+	PredictLanes<kf_simd::LaneScalar>(x_, P_, i, size_, delta_t, noise_ax2_, noise_ay2_);
+}
+
+void KFBank::UpdateLidar(const double *z_px, const double *z_py)
+{
+	int i = UpdateLidarLanes<kf_simd::LaneWide>(x_, P_, 0, size_, z_px, z_py, r_px_, r_py_);
+	UpdateLidarLanes<kf_simd::LaneScalar>(x_, P_, i, size_, z_px, z_py, r_px_, r_py_);
+}
+
+void KFBank::getState(int i, Eigen::VectorXd &x) const
+{
+	x[0] = x_[0][i];
+	x[1] = x_[1][i];
+	x[2] = x_[2][i];
+	x[3] = x_[3][i];
+}
+
+Eigen::Matrix4d KFBank::getCovariance(int i) const
+{
+	Packed packed;
+	for (int k = 0; k < Packed::Size; ++k)
+		packed.data()[k] = P_[k][i];
+	return packed.ToDense();
+}
+
+void KFBank::setLidarNoise(double std_laspx, double std_laspy)
+{
+	r_px_ = std_laspx*std_laspx;
+	r_py_ = std_laspy*std_laspy;
+}
+
+void KFBank::setProcessNoise(double noise_ax2, double noise_ay2)
+{
+	noise_ax2_ = noise_ax2;
+	noise_ay2_ = noise_ay2;
+}
+
+const char *KFBank::LaneName()
+{
+	return KF_SIMD_LANE_NAME;
+}
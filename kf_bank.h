@@ -0,0 +1,90 @@
+#ifndef KF_KF_BANK_H
+#define KF_KF_BANK_H
+
+
+#include "measurement_package.h"
+#include "Eigen/Dense"
+#include "kf_sym_packed.h"
+#include <vector>
+
+/**
+ * A bank of independent constant-velocity tracks with the KF_FUSION model,
+ * stored as structure of arrays.
+ *
+ * Instead of one KF_FUSION (and its matrices) per object, every state and
+ * covariance element of all tracks lives in its own contiguous array (10
+ * for the packed symmetric P instead of 16 for the dense one), so
+ * Predict() and UpdateLidar() sweep the whole bank with SIMD lanes
+ * (see kf_simd.h) and a scalar tail. All tracks share the frame interval
+ * and noise settings; the per-track arithmetic is the same as
+ * KF_FUSION::ProcessMeasurement for lidar measurements.
+ */
+class KFBank {
+public:
+
+	KFBank();
+
+	virtual ~KFBank();
+
+	/**
+	* Appends a track
+	* @param x Initial state (px, py, vx, vy)
+	* @param P Initial state covariance
+	* @return index of the new track
+	*/
+	int AddTrack(const Eigen::Vector4d &x, const Eigen::Matrix4d &P);
+
+	/**
+	* Number of tracks in the bank
+	*/
+	int size() const;
+
+	/**
+	* Predicts every track over delta_t seconds
+	*/
+	void Predict(double delta_t);
+
+	/**
+	* Updates every track with its lidar position measurement
+	* @param z_px Measured x positions, one per track
+	* @param z_py Measured y positions, one per track
+	*/
+	void UpdateLidar(const double *z_px, const double *z_py);
+
+	void getState(int i, Eigen::VectorXd &x) const;
+
+	Eigen::Matrix4d getCovariance(int i) const;
+
+	/**
+	* Lidar measurement noise standard deviations in m
+	*/
+	void setLidarNoise(double std_laspx, double std_laspy);
+
+	/**
+	* Process noise variances of the x and y acceleration
+	*/
+	void setProcessNoise(double noise_ax2, double noise_ay2);
+
+	/**
+	* Name of the widest SIMD lane type compiled in
+	*/
+	static const char *LaneName();
+
+private:
+	int size_;
+
+	// state, one array per element: px, py, vx, vy
+	std::vector<double> x_[4];
+
+	// covariance, one array per element of the packed upper triangle
+	// (see SymPacked<4>)
+	std::vector<double> P_[SymPacked<4>::Size];
+
+	double r_px_;
+	double r_py_;
+	double noise_ax2_;
+	double noise_ay2_;
+};
+
+
+#endif //KF_KF_BANK_H
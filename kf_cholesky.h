@@ -0,0 +1,132 @@
+#ifndef KF_KF_CHOLESKY_H
+#define KF_KF_CHOLESKY_H
+
+
+#include "Eigen/Dense"
+#include <math.h>
+
+/**
+ * Fixed-size Cholesky factor maintenance for square-root filters.
+ *
+ * A square-root filter carries a lower-triangular L with P = L*L^T instead
+ * of P itself. P only changes by sums of outer products, so L can follow
+ * it without ever factorising P again:
+ *   Factor()            L from P, for a start or a restart
+ *   TriangularFactor()  L from a compound matrix C with L*L^T = C*C^T, by
+ *                       a Householder QR of C^T that only keeps R
+ *   RankUpdate()        L*L^T + sigma*v*v^T in O(N^2), by plane rotations
+ *                       (sigma > 0) or hyperbolic rotations (sigma < 0)
+ * Eigen's LLT::rankUpdate and HouseholderQR do the same, but the first
+ * builds a dynamic temporary on every call and the second keeps Q's
+ * reflectors and runs on runtime-sized blocks; these stay on the stack
+ * with compile-time loop bounds.
+ */
+namespace kf_cholesky {
+
+/**
+ * L*L^T = P, reading the lower triangle of P. Unlike Eigen's LLT, which
+ * goes through its blocked algorithm on runtime-sized blocks even for
+ * fixed sizes, the loops here have compile-time bounds and unroll.
+ * @return false when P is not positive definite; L is then incomplete
+ */
+template <typename Scalar, int N>
+inline bool Factor(const Eigen::Matrix<Scalar, N, N> &P, Eigen::Matrix<Scalar, N, N> &L) {
+	L.setZero();
+	for (int j = 0; j < N; ++j) {
+		Scalar d = P(j, j);
+		for (int k = 0; k < j; ++k)
+			d -= L(j, k)*L(j, k);
+		if (!(d > 0))
+			return false;
+		const Scalar l = ::sqrt(d);
+		const Scalar inv_l = 1 / l;
+		L(j, j) = l;
+		for (int i = j + 1; i < N; ++i) {
+			Scalar s = P(i, j);
+			for (int k = 0; k < j; ++k)
+				s -= L(i, k)*L(j, k);
+			L(i, j) = s*inv_l;
+		}
+	}
+	return true;
+}
+
+/**
+ * L*L^T = C*C^T with L lower triangular and a non-negative diagonal.
+ * C is N x M with M >= N, for example the weighted deviations of M points
+ * side by side; M may be Dynamic with a fixed maximum, which keeps it on
+ * the stack.
+ */
+template <typename Scalar, int N, int M, int Options, int MaxM>
+inline void TriangularFactor(const Eigen::Matrix<Scalar, N, M, Options, N, MaxM> &C,
+	Eigen::Matrix<Scalar, N, N> &L) {
+	// Householder QR of C^T = Q*R, keeping only R: C*C^T = R^T*R. Each
+	// reflection zeroes the tail of one column of A = C^T; Q is never formed
+	Eigen::Matrix<Scalar, M, N, Eigen::ColMajor, MaxM, N> A = C.transpose();
+	const int m = int(A.rows());
+	L.setZero();
+	for (int k = 0; k < N; ++k) {
+		Scalar norm2 = 0;
+		for (int i = k; i < m; ++i)
+			norm2 += A(i, k)*A(i, k);
+		const Scalar norm = ::sqrt(norm2);
+		// v = A(k:, k) - alpha*e1 with alpha = -sign(A(k, k))*norm, no cancellation
+		const Scalar alpha = A(k, k) > 0 ? -norm : norm;
+		const Scalar v0 = A(k, k) - alpha;
+		const Scalar vv = norm2 - A(k, k)*A(k, k) + v0*v0;
+		L(k, k) = ::fabs(alpha);
+		if (!(vv > 0)) {
+			// a zero column: no reflection, row k of R is A's as it stands
+			for (int j = k + 1; j < N; ++j)
+				L(j, k) = A(k, j);
+			continue;
+		}
+		const Scalar beta = 2 / vv;
+		A(k, k) = v0;
+		for (int j = k + 1; j < N; ++j) {
+			Scalar dot = 0;
+			for (int i = k; i < m; ++i)
+				dot += A(i, k)*A(i, j);
+			dot *= beta;
+			for (int i = k; i < m; ++i)
+				A(i, j) -= dot*A(i, k);
+			// row k of R, with the sign of the diagonal moved into L's column
+			L(j, k) = alpha > 0 ? A(k, j) : -A(k, j);
+		}
+	}
+}
+
+/**
+ * L*L^T += sigma*v*v^T in place, L lower triangular with a positive
+ * diagonal.
+ * @return false when a downdate (sigma < 0) would leave L*L^T without a
+ * positive definite factor; L is then partly modified, so callers that
+ * want to carry on should work on a copy
+ */
+template <typename Scalar, int N>
+inline bool RankUpdate(Eigen::Matrix<Scalar, N, N> &L, Eigen::Matrix<Scalar, N, 1> v, Scalar sigma) {
+	if (sigma == 0)
+		return true;
+	const Scalar sign = sigma > 0 ? Scalar(1) : Scalar(-1);
+	v *= ::sqrt(sign*sigma);
+	for (int k = 0; k < N; ++k) {
+		const Scalar l = L(k, k);
+		const Scalar r2 = l*l + sign*v[k]*v[k];
+		if (!(r2 > 0) || !(l > 0))
+			return false;
+		const Scalar r = ::sqrt(r2);
+		const Scalar inv_l = 1 / l;
+		const Scalar c = r*inv_l, s = v[k]*inv_l, inv_c = l / r;
+		L(k, k) = r;
+		for (int i = k + 1; i < N; ++i) {
+			L(i, k) = (L(i, k) + sign*s*v[i])*inv_c;
+			v[i] = c*v[i] - s*L(i, k);
+		}
+	}
+	return true;
+}
+
+}
+
+
+#endif //KF_KF_CHOLESKY_H
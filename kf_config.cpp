@@ -0,0 +1,252 @@
+#include "kf_config.h"
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <math.h>
+
+namespace {
+
+typedef FilterConfig::CV CV;
+typedef FilterConfig::CTRV CTRV;
+
+// config key, the CV and/or CTRV field it sets, and whether it is an
+// initial variance (positive) rather than a noise deviation (non-negative)
+struct Field {
+	const char *key;
+	float CV::*cv;
+	double CTRV::*ctrv;
+	bool variance;
+};
+
+const Field kFields[] = {
+	{ "std_laspx_", &CV::std_laspx, &CTRV::std_laspx, false },
+	{ "std_laspy_", &CV::std_laspy, &CTRV::std_laspy, false },
+	{ "std_radpx_", &CV::std_radpx, 0, false },
+	{ "std_radpy_", &CV::std_radpy, 0, false },
+	{ "std_vx_", &CV::std_vx, 0, false },
+	{ "std_vy_", &CV::std_vy, 0, false },
+	{ "std_radrho_", 0, &CTRV::std_radrho, false },
+	{ "std_radphi_", 0, &CTRV::std_radphi, false },
+	{ "std_radrhodot_", 0, &CTRV::std_radrhodot, false },
+	{ "px_", &CV::px, 0, true },
+	{ "py_", &CV::py, 0, true },
+	{ "pvx_", &CV::pvx, 0, true },
+	{ "pvy_", &CV::pvy, 0, true },
+	{ "px", 0, &CTRV::px, true },
+	{ "py", 0, &CTRV::py, true },
+	{ "pv", 0, &CTRV::pv, true },
+	{ "ptheta", 0, &CTRV::ptheta, true },
+	{ "pomiga", 0, &CTRV::pomiga, true },
+};
+const int kFieldCount = sizeof(kFields) / sizeof(kFields[0]);
+
+template <typename T>
+bool ParseValue(const std::string &text, T &value) {
+	std::istringstream iss(text);
+	T parsed;
+	if (!(iss >> parsed))
+		return false;
+	value = parsed;
+	return true;
+}
+
+bool CheckValue(const Field &field, double value, std::string *error) {
+	bool ok = field.variance ? value > 0 : value >= 0;
+	if (ok && isfinite(value))
+		return true;
+	if (error) {
+		std::ostringstream msg;
+		msg << field.key << " = " << value << ": expected a "
+			<< (field.variance ? "positive" : "non-negative") << " finite value";
+		*error = msg.str();
+	}
+	return false;
+}
+
+}
+
+FilterConfig::FilterConfig() {
+	cv.std_laspx = 0.05f;
+	cv.std_laspy = 0.05f;
+	cv.std_radpx = 0.3f;
+	cv.std_radpy = 0.3f;
+	cv.std_vx = 1.3f;
+	cv.std_vy = 1.3f;
+	cv.px = 1;
+	cv.py = 1;
+	cv.pvx = 0.5f;
+	cv.pvy = 0.5f;
+
+	ctrv.std_laspx = 0.15;
+	ctrv.std_laspy = 0.15;
+	ctrv.std_radrho = 0.02;
+	ctrv.std_radphi = 0.01;
+	ctrv.std_radrhodot = 0.2;
+	ctrv.px = 0.25;
+	ctrv.py = 0.25;
+	ctrv.pv = 0.3;
+	ctrv.ptheta = 0.2;
+	ctrv.pomiga = 1.0;
+}
+
+bool FilterConfig::Parse(std::istream &in, std::string *error) {
+	std::string line;
+	int line_number = 0;
+	while (getline(in, line)) {
+		++line_number;
+		std::istringstream iss(line);
+		std::string key, value;
+		iss >> key;
+		getline(iss, value);
+		for (int i = 0; i < kFieldCount; ++i) {
+			const Field &field = kFields[i];
+			if (key != field.key)
+				continue;
+			// the CV filter has always read its values as float, CTRV as double
+			bool ok = (!field.cv || ParseValue(value, cv.*field.cv))
+				&& (!field.ctrv || ParseValue(value, ctrv.*field.ctrv));
+			if (!ok) {
+				if (error) {
+					std::ostringstream msg;
+					msg << "line " << line_number << ": cannot parse a value for " << key;
+					*error = msg.str();
+				}
+				return false;
+			}
+			break;
+		}
+	}
+	return true;
+}
+
+bool FilterConfig::Validate(std::string *error) const {
+	for (int i = 0; i < kFieldCount; ++i) {
+		const Field &field = kFields[i];
+		if (field.cv && !CheckValue(field, cv.*field.cv, error))
+			return false;
+		if (field.ctrv && !CheckValue(field, ctrv.*field.ctrv, error))
+			return false;
+	}
+	return true;
+}
+
+bool FilterConfig::operator==(const FilterConfig &other) const {
+	for (int i = 0; i < kFieldCount; ++i) {
+		const Field &field = kFields[i];
+		if (field.cv && cv.*field.cv != other.cv.*field.cv)
+			return false;
+		if (field.ctrv && ctrv.*field.ctrv != other.ctrv.*field.ctrv)
+			return false;
+	}
+	return true;
+}
+
+std::shared_ptr<const FilterConfig> FilterConfig::FromStream(std::istream &in, std::string *error) {
+	std::shared_ptr<FilterConfig> config = std::make_shared<FilterConfig>();
+	if (!config->Parse(in, error) || !config->Validate(error))
+		return std::shared_ptr<const FilterConfig>();
+	return config;
+}
+
+std::shared_ptr<const FilterConfig> FilterConfig::Load(const std::string &path, std::string *error) {
+	std::ifstream in(path.c_str(), std::ifstream::in);
+	if (!in.is_open()) {
+		if (error)
+			*error = "cannot open " + path;
+		return std::shared_ptr<const FilterConfig>();
+	}
+	std::string reason;
+	std::shared_ptr<const FilterConfig> config = FromStream(in, &reason);
+	if (!config && error)
+		*error = path + ": " + reason;
+	return config;
+}
+
+std::shared_ptr<const FilterConfig> FilterConfig::Default() {
+	struct Loader {
+		static std::shared_ptr<const FilterConfig> Run() {
+			std::string error;
+			std::shared_ptr<const FilterConfig> config = Load("../config.txt", &error);
+			if (!config) {
+				std::cerr << error << ", using the built-in filter defaults" << std::endl;
+				config = std::make_shared<FilterConfig>();
+			}
+			return config;
+		}
+	};
+	static const std::shared_ptr<const FilterConfig> config = Loader::Run();
+	return config;
+}
+
+ConfigPublisher::ConfigPublisher(std::shared_ptr<const FilterConfig> config)
+	: config_(config), version_(0) {}
+
+void ConfigPublisher::Publish(std::shared_ptr<const FilterConfig> config) {
+	// snapshot first, so a reader that sees the new version gets at least
+	// this snapshot
+	std::atomic_store(&config_, config);
+	version_.fetch_add(1, std::memory_order_release);
+}
+
+std::shared_ptr<const FilterConfig> ConfigPublisher::Get() const {
+	return std::atomic_load(&config_);
+}
+
+ConfigPublisher &ConfigPublisher::Default() {
+	static ConfigPublisher publisher(FilterConfig::Default());
+	return publisher;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string &path, ConfigPublisher &publisher, int period_ms)
+	: path_(path), publisher_(publisher), period_ms_(period_ms), reloads_(0), rejected_(0),
+	stop_(false) {
+	thread_ = std::thread(&ConfigWatcher::Run, this);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	thread_.join();
+}
+
+bool ConfigWatcher::Poll() {
+	std::lock_guard<std::mutex> lock(poll_mutex_);
+	std::ifstream in(path_.c_str(), std::ifstream::in);
+	if (!in.is_open())
+		return false;
+	std::ostringstream text;
+	text << in.rdbuf();
+	if (text.str() == last_text_)
+		return false;
+	last_text_ = text.str();
+
+	std::istringstream parse(last_text_);
+	std::string error;
+	std::shared_ptr<const FilterConfig> config = FilterConfig::FromStream(parse, &error);
+	if (!config) {
+		rejected_.fetch_add(1, std::memory_order_relaxed);
+		std::cerr << path_ << ": " << error << ", keeping the previous config" << std::endl;
+		return false;
+	}
+	// unchanged values (the first check, an edited comment) would only bump
+	// the version and make the filters reset their noise
+	if (*config == *publisher_.Get())
+		return false;
+	publisher_.Publish(config);
+	reloads_.fetch_add(1, std::memory_order_relaxed);
+	return true;
+}
+
+void ConfigWatcher::Run() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (!stop_) {
+		lock.unlock();
+		Poll();
+		lock.lock();
+		wake_.wait_for(lock, std::chrono::milliseconds(period_ms_));
+	}
+}
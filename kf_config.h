@@ -0,0 +1,194 @@
+#ifndef KF_KF_CONFIG_H
+#define KF_KF_CONFIG_H
+
+
+#include <atomic>
+#include <condition_variable>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Measurement noise and initial covariance of the filters, as read from
+ * config.txt.
+ *
+ * The file is a list of "key value" lines; unknown keys are ignored and a
+ * key missing from the file keeps the filter's built-in default. Each
+ * filter reads its own keys (KF_FUSION: std_laspx_, std_radpx_, std_vx_,
+ * px_, ...; EKF_CTRV: std_laspx_, std_radrho_, px, ...), so the values are
+ * kept per filter, with the types the filters have always parsed them as.
+ *
+ * A FilterConfig is parsed and validated once and then shared, immutable,
+ * by every filter instance through a shared_ptr; constructing a filter no
+ * longer touches the file system. To change values at run time, publish a
+ * new FilterConfig through a ConfigPublisher (see ConfigWatcher).
+ */
+class FilterConfig {
+public:
+	/**
+	* KF_FUSION: lidar, cartesian radar and lidar+radar on the CV model
+	*/
+	struct CV {
+		// lidar position noise, m
+		float std_laspx, std_laspy;
+		// cartesian radar position noise, m
+		float std_radpx, std_radpy;
+		// cartesian radar velocity noise, m/s
+		float std_vx, std_vy;
+		// initial covariance diagonal
+		float px, py, pvx, pvy;
+	};
+
+	/**
+	* EKF_CTRV: lidar and polar radar on the CTRV model
+	*/
+	struct CTRV {
+		// lidar position noise, m
+		double std_laspx, std_laspy;
+		// radar range (m), bearing (rad) and range rate (m/s) noise
+		double std_radrho, std_radphi, std_radrhodot;
+		// initial covariance diagonal
+		double px, py, pv, ptheta, pomiga;
+	};
+
+	CV cv;
+	CTRV ctrv;
+
+	/**
+	* Built-in defaults of the filters
+	*/
+	FilterConfig();
+
+	/**
+	* Reads "key value" lines over the current values
+	* @return false with a message in error (if not null) on a value that
+	* does not parse
+	*/
+	bool Parse(std::istream &in, std::string *error);
+
+	/**
+	* Checks that noise deviations are finite and non-negative and initial
+	* variances finite and positive
+	*/
+	bool Validate(std::string *error) const;
+
+	/**
+	* True when every value equals other's
+	*/
+	bool operator==(const FilterConfig &other) const;
+
+	/**
+	* Parses and validates config text
+	* @return null, with a message in error (if not null), when invalid
+	*/
+	static std::shared_ptr<const FilterConfig> FromStream(std::istream &in, std::string *error);
+
+	/**
+	* Parses and validates a config file
+	* @return null, with a message in error (if not null), when the file
+	* cannot be read or is invalid
+	*/
+	static std::shared_ptr<const FilterConfig> Load(const std::string &path, std::string *error);
+
+	/**
+	* Process-wide config, loaded from ../config.txt on first use. When that
+	* fails the reason goes to std::cerr and the built-in defaults are used.
+	*/
+	static std::shared_ptr<const FilterConfig> Default();
+};
+
+/**
+ * Publication point for FilterConfig snapshots, read-copy-update style.
+ *
+ * Publish() swaps in a new immutable snapshot and then bumps version().
+ * A filter following a publisher compares version() with the version it
+ * last applied at each update; that single atomic load is all the hot path
+ * pays. Only when it has changed does the filter take the new snapshot
+ * with Get(). A replaced snapshot is freed once the last filter holding it
+ * has moved on.
+ */
+class ConfigPublisher {
+public:
+	explicit ConfigPublisher(std::shared_ptr<const FilterConfig> config);
+
+	/**
+	* Makes config the current snapshot
+	*/
+	void Publish(std::shared_ptr<const FilterConfig> config);
+
+	/**
+	* The current snapshot
+	*/
+	std::shared_ptr<const FilterConfig> Get() const;
+
+	///* incremented by every Publish()
+	unsigned version() const { return version_.load(std::memory_order_acquire); }
+
+	/**
+	* Publisher the filters follow by default, starting from
+	* FilterConfig::Default()
+	*/
+	static ConfigPublisher &Default();
+
+private:
+	std::shared_ptr<const FilterConfig> config_;
+	std::atomic<unsigned> version_;
+
+	ConfigPublisher(const ConfigPublisher &);
+	ConfigPublisher &operator=(const ConfigPublisher &);
+};
+
+/**
+ * Background thread that re-reads a config file every period and, when its
+ * text has changed, parses and validates it and publishes it if its values
+ * differ from the current snapshot's. An invalid file is reported on
+ * std::cerr and the previous snapshot stays in place. The first check runs
+ * as soon as the thread starts; it publishes nothing when the file holds
+ * the values already published, so filters keep their state.
+ */
+class ConfigWatcher {
+public:
+	ConfigWatcher(const std::string &path, ConfigPublisher &publisher, int period_ms = 1000);
+
+	/**
+	* Stops and joins the thread
+	*/
+	~ConfigWatcher();
+
+	/**
+	* Checks the file now
+	* @return true when a new snapshot was published
+	*/
+	bool Poll();
+
+	///* snapshots published so far
+	long reloads() const { return reloads_.load(std::memory_order_relaxed); }
+
+	///* changed files that failed to load
+	long rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+private:
+	void Run();
+
+	std::string path_;
+	ConfigPublisher &publisher_;
+	int period_ms_;
+	// text of the last file checked, guarded by poll_mutex_
+	std::string last_text_;
+	std::mutex poll_mutex_;
+	std::atomic<long> reloads_;
+	std::atomic<long> rejected_;
+
+	std::mutex mutex_;
+	std::condition_variable wake_;
+	bool stop_;
+	std::thread thread_;
+
+	ConfigWatcher(const ConfigWatcher &);
+	ConfigWatcher &operator=(const ConfigWatcher &);
+};
+
+
+#endif //KF_KF_CONFIG_H
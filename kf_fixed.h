@@ -0,0 +1,189 @@
+#ifndef KF_KF_FIXED_H
+#define KF_KF_FIXED_H
+
+
+#include "measurement_package.h"
+#include "Eigen/Dense"
+#include "kf_alloc_guard.h"
+#include "kf_update.h"
+#include "kf_propagate.h"
+#include "kf_radar.h"
+#include <math.h>
+
+/**
+ * Kalman filter with a compile-time state dimension.
+ *
+ * Same equations as KF, but x_, P_, F_ and Q_ are fixed-size Eigen objects,
+ * so Predict() and the update calls run entirely on the stack. The
+ * measurement dimension is deduced from H at each update call, which lets
+ * one filter take lidar (2), radar (3) and cartesian radar (4) updates.
+ * Every temporary is a fixed-size stack object, so no workspace is needed.
+ */
+template <int NX, typename Scalar = double>
+class KF_FIXED {
+public:
+	typedef Eigen::Matrix<Scalar, NX, 1> StateVector;
+	typedef Eigen::Matrix<Scalar, NX, NX> StateMatrix;
+
+	///* state vector
+	StateVector x_;
+
+	///* state covariance matrix
+	StateMatrix P_;
+
+	// state transition matrix
+	StateMatrix F_;
+
+	// process covariance matrix
+	StateMatrix Q_;
+
+	///* if true, updates with a diagonal R are applied one scalar
+	///* component at a time instead of as one joint update
+	bool sequential_update_;
+
+	///* if true, PredictCV() falls back to the dense Predict()
+	bool dense_predict_;
+
+	///* form of the covariance update, see kf_update::CovarianceUpdate
+	kf_update::CovarianceUpdate covariance_update_;
+
+	KF_FIXED() {
+		x_.setZero();
+		P_.setIdentity();
+		F_.setIdentity();
+		Q_.setZero();
+		sequential_update_ = false;
+		dense_predict_ = false;
+		covariance_update_ = kf_update::SYMMETRIC_UPDATE;
+	}
+
+	virtual ~KF_FIXED() {}
+
+	/**
+	* Prediction Predicts the state and the state covariance
+	* using the process model
+	*/
+	void Predict() {
+		KFNoMallocScope no_malloc;
+		x_ = F_*x_;
+		P_ = F_*P_*F_.transpose() + Q_;
+	}
+
+	/**
+	* Predict for the constant-velocity transition F_ = [I dt*I; 0 I] with
+	* dt = F_(0,2), using only the non-trivial blocks of F_
+	*/
+	void PredictCV() {
+		static_assert(NX == 4, "PredictCV needs the 4-state CV model");
+		if (dense_predict_) {
+			Predict();
+			return;
+		}
+		const Scalar dt = F_(0, 2);
+		x_[0] += dt*x_[2];
+		x_[1] += dt*x_[3];
+		kf_propagate::PropagateCV(P_, dt);
+		P_ += Q_;
+	}
+
+	/**
+	* Updates the state by using standard Kalman Filter equations
+	* @param z The measurement at k+1
+	* @param H Measurement matrix
+	* @param R Measurement covariance matrix
+	*/
+	template <int NZ, typename DerivedZ>
+	void Update(const Eigen::MatrixBase<DerivedZ> &z,
+		const Eigen::Matrix<Scalar, NZ, NX> &H, const Eigen::Matrix<Scalar, NZ, NZ> &R) {
+		Eigen::Matrix<Scalar, NZ, 1> y = z - H*x_;
+		KalmanFilter(y, H, R);
+	}
+
+	/**
+	* Updates the state by using Extended Kalman Filter equations for the
+	* CV radar model (rho, phi, rho_dot)
+	* @param z The measurement at k+1
+	* @param Hj Jacobian of the radar measurement function at x_
+	* @param R Measurement covariance matrix
+	*/
+	template <typename DerivedZ>
+	void UpdateEKF(const Eigen::MatrixBase<DerivedZ> &z,
+		const Eigen::Matrix<Scalar, 3, NX> &Hj, const Eigen::Matrix<Scalar, 3, 3> &R) {
+		float px = x_[0];
+		float py = x_[1];
+		float vx = x_[2];
+		float vy = x_[3];
+		float c1 = px*px + py*py;
+
+		float rho, phi, rho_dot;
+		rho = sqrt(c1);
+		if (rho < 0.000001)
+			rho = 0.000001;
+		phi = atan2(py, px);
+		rho_dot = (px*vx + py*vy) / rho;
+		Eigen::Matrix<Scalar, 3, 1> z_pred;
+		z_pred << rho, phi, rho_dot;
+
+		Eigen::Matrix<Scalar, 3, 1> y = z - z_pred;
+		// normalise the bearing residual to [-pi, pi]
+		while (y(1) > M_PI)
+			y(1) -= DoublePI;
+		while (y(1) < -M_PI)
+			y(1) += DoublePI;
+		KalmanFilter(y, Hj, R);
+	}
+
+	/**
+	* Updates the state with a CV radar measurement (rho, phi, rho_dot),
+	* taking h(x_) and its Jacobian from kf_radar::MeasurementCV
+	* @param z The measurement at k+1
+	* @param R Measurement covariance matrix
+	* @return false, without an update, when x_ is too close to the sensor
+	* for the Jacobian to be defined
+	*/
+	template <typename DerivedZ>
+	bool UpdateRadarCV(const Eigen::MatrixBase<DerivedZ> &z, const Eigen::Matrix<Scalar, 3, 3> &R) {
+		static_assert(NX == 4, "UpdateRadarCV needs the 4-state CV model");
+		Eigen::Matrix<Scalar, 3, 1> h;
+		Eigen::Matrix<Scalar, 3, NX> H;
+		if (!kf_radar::MeasurementCV(x_, h, H))
+			return false;
+		Eigen::Matrix<Scalar, 3, 1> y = z - h;
+		// normalise the bearing residual to [-pi, pi]
+		while (y(1) > M_PI)
+			y(1) -= DoublePI;
+		while (y(1) < -M_PI)
+			y(1) += DoublePI;
+		KalmanFilter(y, H, R);
+		return true;
+	}
+
+	/**
+	* Updates the state from an innovation
+	* @param y The difference between measurement and predicted state at k+1
+	* @param H Measurement matrix
+	* @param R Measurement covariance matrix
+	*/
+	template <int NZ>
+	void KalmanFilter(const Eigen::Matrix<Scalar, NZ, 1> &y,
+		const Eigen::Matrix<Scalar, NZ, NX> &H, const Eigen::Matrix<Scalar, NZ, NZ> &R) {
+		KFNoMallocScope no_malloc;
+		if (sequential_update_ && kf_update::IsDiagonal(R)) {
+			kf_update::SequentialUpdate(x_, P_, y, H, R.diagonal());
+			return;
+		}
+		Eigen::Matrix<Scalar, NX, NZ> PHT = P_*H.transpose();
+		Eigen::Matrix<Scalar, NZ, NZ> S = H*PHT + R;
+		Eigen::Matrix<Scalar, NX, NZ> K;
+		if (!kf_update::SolveGain(S, PHT, K))
+			return;
+
+		x_ += K*y;
+		kf_update::UpdateCovariance(P_, K, H, S, R, covariance_update_);
+	}
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+#endif //KF_KF_FIXED_H
@@ -0,0 +1,42 @@
+#include "kf_grouper.h"
+#include <algorithm>
+#include <math.h>
+
+MeasurementGrouper::MeasurementGrouper(double window_us)
+	: window_us_(window_us), has_pending_(false), stacked_(0) {}
+
+bool MeasurementGrouper::Push(const MeasurementPackage &meas, MeasurementPackage &out) {
+	if (!has_pending_) {
+		pending_ = meas;
+		has_pending_ = true;
+		return false;
+	}
+
+	const bool pair = (pending_.sensor_type_ == MeasurementPackage::LASER
+		&& meas.sensor_type_ == MeasurementPackage::RADAR)
+		|| (pending_.sensor_type_ == MeasurementPackage::RADAR
+		&& meas.sensor_type_ == MeasurementPackage::LASER);
+	if (!pair || fabs(meas.timestamp_ - pending_.timestamp_) > window_us_) {
+		out = pending_;
+		pending_ = meas;
+		return true;
+	}
+
+	const MeasurementPackage &lidar = meas.sensor_type_ == MeasurementPackage::LASER ? meas : pending_;
+	const MeasurementPackage &radar = meas.sensor_type_ == MeasurementPackage::RADAR ? meas : pending_;
+	out.sensor_type_ = MeasurementPackage::LASER_RADAR;
+	out.timestamp_ = std::max(lidar.timestamp_, radar.timestamp_);
+	out.raw_measurements_.resize(6);
+	out.raw_measurements_ << lidar.raw_measurements_.head<2>(), radar.raw_measurements_.head<4>();
+	has_pending_ = false;
+	++stacked_;
+	return true;
+}
+
+bool MeasurementGrouper::Flush(MeasurementPackage &out) {
+	if (!has_pending_)
+		return false;
+	out = pending_;
+	has_pending_ = false;
+	return true;
+}
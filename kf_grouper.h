@@ -0,0 +1,52 @@
+#ifndef KF_KF_GROUPER_H
+#define KF_KF_GROUPER_H
+
+
+#include "measurement_package.h"
+
+/**
+ * Fusion front-end that merges a lidar and a radar measurement taken
+ * within a time window into one stacked LASER_RADAR measurement, so that
+ * KF_FUSION runs a single predict and one joint update for the pair
+ * instead of two predict+update cycles.
+ *
+ * Measurements are pushed in timestamp order, radar already in cartesian
+ * form (px, py, vx, vy) as KF_FUSION takes it. The stacked measurement is
+ * (lidar px, lidar py, radar px, radar py, radar vx, radar vy) with the
+ * later of the two timestamps. Each measurement is held until the next
+ * one shows whether it has a partner, so output lags input by one
+ * measurement; Flush() releases the last one.
+ */
+class MeasurementGrouper {
+public:
+	/**
+	* @param window_us Largest timestamp difference (microseconds) of a
+	* lidar/radar pair that is stacked; 0 stacks only equal timestamps
+	*/
+	explicit MeasurementGrouper(double window_us = 0);
+
+	/**
+	* Adds the next measurement
+	* @param out Receives a measurement ready for the filter
+	* @return true when out was filled
+	*/
+	bool Push(const MeasurementPackage &meas, MeasurementPackage &out);
+
+	/**
+	* Releases the held measurement, if any
+	* @return true when out was filled
+	*/
+	bool Flush(MeasurementPackage &out);
+
+	///* lidar/radar pairs stacked so far
+	long stacked() const { return stacked_; }
+
+private:
+	double window_us_;
+	bool has_pending_;
+	MeasurementPackage pending_;
+	long stacked_;
+};
+
+
+#endif //KF_KF_GROUPER_H
@@ -0,0 +1,140 @@
+#include "kf_merge.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+}
+
+MeasurementMerger::MeasurementMerger(int sources, double reorder_window_us, int capacity)
+	: window_us_(reorder_window_us), capacity_(capacity), watermark_(-kInfinity),
+	last_released_(-kInfinity), sequence_(0), released_(0), late_drops_(0), overflow_drops_(0), forced_(0) {
+	Source source;
+	source.newest = -kInfinity;
+	source.late_drops = 0;
+	source.overflow_drops = 0;
+	sources_.assign(sources, source);
+	for (int i = 0; i < sources; ++i) {
+		sources_[i].position = i;
+		open_.push_back(i);
+	}
+	slots_.resize(capacity);
+	free_slots_.reserve(capacity);
+	for (int i = capacity - 1; i >= 0; --i)
+		free_slots_.push_back(i);
+	heap_.reserve(capacity);
+	UpdateWatermark();
+}
+
+bool MeasurementMerger::Push(int source, const MeasurementView &meas) {
+	Source &from = sources_[source];
+	if (meas.timestamp_ < last_released_) {
+		++from.late_drops;
+		++late_drops_;
+		return false;
+	}
+
+	if (free_slots_.empty()) {
+		++from.overflow_drops;
+		++overflow_drops_;
+		return false;
+	}
+	Node node;
+	node.timestamp = meas.timestamp_;
+	node.sequence = sequence_++;
+	node.slot = free_slots_.back();
+	free_slots_.pop_back();
+	// same-sized raw_measurements_ are copied into the slot without
+	// reallocating
+	slots_[node.slot].Assign(meas);
+	heap_.push_back(node);
+	std::push_heap(heap_.begin(), heap_.end(), Later());
+
+	if (meas.timestamp_ > from.newest) {
+		from.newest = meas.timestamp_;
+		if (from.position >= 0) {
+			SiftDown(from.position);
+			UpdateWatermark();
+		}
+	}
+	return true;
+}
+
+bool MeasurementMerger::Pop(MeasurementPackage &out) {
+	if (heap_.empty())
+		return false;
+	const Node &top = heap_.front();
+	const bool full = static_cast<int>(heap_.size()) >= capacity_;
+	if (top.timestamp > watermark_ && !full)
+		return false;
+	if (top.timestamp > watermark_)
+		++forced_;
+
+	const int slot = top.slot;
+	last_released_ = top.timestamp;
+	std::pop_heap(heap_.begin(), heap_.end(), Later());
+	heap_.pop_back();
+	out = slots_[slot];
+	free_slots_.push_back(slot);
+	++released_;
+	return true;
+}
+
+void MeasurementMerger::Close(int source) {
+	const int position = sources_[source].position;
+	if (position < 0)
+		return;
+	sources_[source].position = -1;
+	const int last = open_.back();
+	open_.pop_back();
+	if (last != source) {
+		// the last source only moves towards the root if it is older than
+		// its new parent
+		open_[position] = last;
+		sources_[last].position = position;
+		int i = position;
+		while (i > 0) {
+			const int parent = (i - 1) / 2;
+			if (sources_[open_[parent]].newest <= sources_[open_[i]].newest)
+				break;
+			std::swap(open_[parent], open_[i]);
+			sources_[open_[parent]].position = parent;
+			sources_[open_[i]].position = i;
+			i = parent;
+		}
+		SiftDown(i);
+	}
+	UpdateWatermark();
+}
+
+void MeasurementMerger::Finish() {
+	for (size_t i = 0; i < open_.size(); ++i)
+		sources_[open_[i]].position = -1;
+	open_.clear();
+	UpdateWatermark();
+}
+
+void MeasurementMerger::SiftDown(int position) {
+	const int n = static_cast<int>(open_.size());
+	int i = position;
+	for (;;) {
+		int smallest = i;
+		const int left = 2 * i + 1, right = left + 1;
+		if (left < n && sources_[open_[left]].newest < sources_[open_[smallest]].newest)
+			smallest = left;
+		if (right < n && sources_[open_[right]].newest < sources_[open_[smallest]].newest)
+			smallest = right;
+		if (smallest == i)
+			break;
+		std::swap(open_[i], open_[smallest]);
+		sources_[open_[i]].position = i;
+		sources_[open_[smallest]].position = smallest;
+		i = smallest;
+	}
+}
+
+void MeasurementMerger::UpdateWatermark() {
+	watermark_ = open_.empty() ? kInfinity : sources_[open_[0]].newest - window_us_;
+}
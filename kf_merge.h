@@ -0,0 +1,132 @@
+#ifndef KF_KF_MERGE_H
+#define KF_KF_MERGE_H
+
+
+#include "measurement_package.h"
+#include <vector>
+
+/**
+ * Streaming k-way merge of per-sensor measurement streams into one stream
+ * in timestamp order, for filters that expect what data_synthetic.txt
+ * provides: a single pre-interleaved, sorted sequence.
+ *
+ * Each source (a lidar log, a radar socket, ...) pushes its measurements
+ * as they arrive, roughly in its own timestamp order. They are held in a
+ * min-heap on timestamp (arrival order breaks ties). A measurement is
+ * released once it is older than the watermark: the newest timestamp seen
+ * from the slowest open source, minus the reorder window. Arrivals up to
+ * the window behind their source therefore still come out in order. An
+ * arrival older than what has already been released is dropped and
+ * counted as late.
+ *
+ * Slots for capacity measurements are allocated up front and the buffer
+ * never grows. Once capacity measurements are held, Pop() releases the
+ * oldest regardless of the watermark, so a silent source cannot stall the
+ * others for longer than the buffer lasts; an arrival pushed while the
+ * buffer is full (pushing more without popping) is dropped and counted as
+ * an overflow. Close() a source that has ended and Finish() at the end of
+ * input to drain the rest.
+ *
+ * Use:
+ *   merger.Push(source, meas);
+ *   while (merger.Pop(out))
+ *       filter.ProcessMeasurement(out);
+ */
+class MeasurementMerger {
+public:
+	/**
+	* @param sources Number of input streams
+	* @param reorder_window_us How far (microseconds) a source's measurement
+	* may arrive behind its newest one and still be merged in order
+	* @param capacity Measurements held before releases are forced
+	*/
+	MeasurementMerger(int sources, double reorder_window_us, int capacity = 1024);
+
+	/**
+	* Adds a measurement from a source
+	* @return false when it was dropped as late or because the buffer
+	* was full
+	*/
+	bool Push(int source, const MeasurementView &meas);
+
+	/**
+	* Takes the next measurement in timestamp order
+	* @return true when out was filled
+	*/
+	bool Pop(MeasurementPackage &out);
+
+	/**
+	* Marks a source as ended; it no longer holds back the watermark
+	*/
+	void Close(int source);
+
+	/**
+	* Closes every source, so that Pop() drains all held measurements
+	*/
+	void Finish();
+
+	///* measurements held
+	int size() const { return static_cast<int>(heap_.size()); }
+
+	///* measurements released by Pop()
+	long released() const { return released_; }
+
+	///* late measurements dropped, over all sources and from one source
+	long late_drops() const { return late_drops_; }
+	long late_drops(int source) const { return sources_[source].late_drops; }
+
+	///* arrivals dropped because the buffer was full, over all sources
+	///* and from one source
+	long overflow_drops() const { return overflow_drops_; }
+	long overflow_drops(int source) const { return sources_[source].overflow_drops; }
+
+	///* releases forced by a full buffer
+	long forced() const { return forced_; }
+
+private:
+	struct Source {
+		// newest timestamp pushed, -infinity before the first
+		double newest;
+		// index in open_, -1 once closed
+		int position;
+		long late_drops;
+		long overflow_drops;
+	};
+
+	struct Node {
+		double timestamp;
+		long sequence;
+		int slot;
+	};
+
+	struct Later {
+		bool operator()(const Node &a, const Node &b) const {
+			return a.timestamp > b.timestamp || (a.timestamp == b.timestamp && a.sequence > b.sequence);
+		}
+	};
+
+	// restores the open_ heap after sources_[source].newest increased
+	void SiftDown(int position);
+	void UpdateWatermark();
+
+	std::vector<Source> sources_;
+	double window_us_;
+	int capacity_;
+	// held measurements live in slots_, the heap orders their indices
+	std::vector<MeasurementPackage> slots_;
+	std::vector<int> free_slots_;
+	std::vector<Node> heap_;
+	// open sources, a min-heap on their newest timestamp, so that the
+	// slowest one is open_[0]
+	std::vector<int> open_;
+	double watermark_;
+	double last_released_;
+	long sequence_;
+	long released_;
+	long late_drops_;
+	long overflow_drops_;
+	long forced_;
+};
+
+
+#endif //KF_KF_MERGE_H
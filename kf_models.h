@@ -0,0 +1,50 @@
+#ifndef KF_KF_MODELS_H
+#define KF_KF_MODELS_H
+
+
+#include <cmath>  // not <math.h>, see kf_autodiff.h
+
+/**
+ * Measurement functions of the motion models, written once for plain
+ * scalars and for kf_autodiff::Dual (see kf_autodiff.h), which derives
+ * their Jacobians. Constants are written as double literals so that they
+ * combine with Dual<double, N>. The CTRV process Jacobian stays
+ * hand-written (EKF_CTRV::ProcessJAMatrix), as it shares its sin/cos
+ * pairs with the state transition and Q.
+ *
+ * CV state:   (px, py, vx, vy)
+ * CTRV state: (px, py, v, yaw, yaw rate)
+ * radar:      (rho, phi, rho_dot)
+ */
+namespace kf_models {
+
+/**
+ * Radar seen from the CTRV state
+ */
+struct CTRVRadar {
+	template <typename T>
+	void operator()(const T *x, T *z) const {
+		const T rho = sqrt(x[0]*x[0] + x[1]*x[1]);
+		z[0] = rho;
+		z[1] = atan2(x[1], x[0]);
+		z[2] = x[2]*(x[0]*cos(x[3]) + x[1]*sin(x[3])) / rho;
+	}
+};
+
+/**
+ * Radar seen from the CV state
+ */
+struct CVRadar {
+	template <typename T>
+	void operator()(const T *x, T *z) const {
+		const T rho = sqrt(x[0]*x[0] + x[1]*x[1]);
+		z[0] = rho;
+		z[1] = atan2(x[1], x[0]);
+		z[2] = (x[0]*x[2] + x[1]*x[3]) / rho;
+	}
+};
+
+}
+
+
+#endif //KF_KF_MODELS_H
@@ -0,0 +1,214 @@
+#ifndef KF_KF_OOSM_H
+#define KF_KF_OOSM_H
+
+
+#include "measurement_package.h"
+#include "Eigen/Dense"
+#include <vector>
+
+/**
+ * State history for out-of-sequence measurements (OOSM).
+ *
+ * A filter that sees a measurement older than its current state would
+ * otherwise predict backwards over a negative dt. With a history of depth
+ * > 0 it records, after every measurement, the measurement together with
+ * the posterior (timestamp, x, P) in a ring buffer. A late measurement is
+ * then handled in one of two ways:
+ *
+ *  - replay: restore the last snapshot at or before the late timestamp,
+ *    process the late measurement, then process again every recorded
+ *    measurement after it. The result is that of in-order processing, at
+ *    one predict + update per step.
+ *  - retrodict: update the current state directly, with the measurement
+ *    model composed with the backward transition to the measurement time
+ *    and the process noise over the lag added to R. One update whatever
+ *    the lag, but approximate: the correlation between that noise and the
+ *    current estimate is ignored, which costs accuracy once the process
+ *    noise over the lag is large next to P.
+ *
+ * In AUTO mode Prepare() picks replay while its cost, replayed steps + 1
+ * predict + update cycles, is at most the cost given to a retrodiction
+ * (setRetrodictCost(), in the same cycles). A measurement older than the
+ * oldest snapshot is dropped, so the depth also bounds the lag handled.
+ *
+ * A retrodicted measurement is inserted into the history at its
+ * timestamp, and the snapshots between it and the newest are marked
+ * stale: a later replay starts from the last snapshot that is still valid
+ * and so re-processes the retrodicted measurement exactly.
+ *
+ * The filter keeps the history next to its state and calls Record(),
+ * Prepare(), Insert() and Store(); the history itself runs no filter code.
+ */
+template <typename StateVector, typename StateMatrix>
+class OosmHistory {
+public:
+	enum Mode { AUTO, REPLAY, RETRODICT };
+
+	struct Entry {
+		double timestamp;
+		MeasurementPackage meas;
+		StateVector x;
+		StateMatrix P;
+		// x and P are the posterior after meas and everything before it
+		bool valid;
+
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	};
+
+	/**
+	* How a late measurement is handled
+	*/
+	struct Plan {
+		bool replay;
+		// replay: index of the snapshot to restore
+		int from;
+		// replay: recorded measurements to process again after the late one
+		int steps;
+	};
+
+	OosmHistory() : head_(0), size_(0), mode_(AUTO), retrodict_cost_(3),
+		replays_(0), replayed_steps_(0), retrodictions_(0), late_drops_(0) {}
+
+	/**
+	* Number of snapshots kept; 0 (the default) turns OOSM handling off.
+	* Clears the history.
+	*/
+	void setDepth(int depth) {
+		entries_.resize(depth);
+		head_ = 0;
+		size_ = 0;
+	}
+
+	int depth() const { return static_cast<int>(entries_.size()); }
+	bool enabled() const { return !entries_.empty(); }
+
+	void setMode(Mode mode) { mode_ = mode; }
+
+	/**
+	* Cost of a retrodiction, in predict + update cycles (default 3)
+	*/
+	void setRetrodictCost(double cycles) { retrodict_cost_ = cycles; }
+
+	void Clear() { size_ = 0; }
+
+	///* snapshots held, oldest first
+	int size() const { return size_; }
+	Entry &at(int i) { return entries_[(head_ + i) % entries_.size()]; }
+	const Entry &at(int i) const { return entries_[(head_ + i) % entries_.size()]; }
+
+	/**
+	* Appends the posterior after an in-order measurement, dropping the
+	* oldest snapshot when full
+	*/
+	void Record(const MeasurementView &meas, const StateVector &x, const StateMatrix &P) {
+		if (!enabled())
+			return;
+		if (size_ == depth()) {
+			head_ = (head_ + 1) % entries_.size();
+			--size_;
+		}
+		Entry &entry = at(size_++);
+		entry.timestamp = meas.timestamp_;
+		entry.meas.Assign(meas);
+		entry.x = x;
+		entry.P = P;
+		entry.valid = true;
+	}
+
+	/**
+	* Chooses how to handle a measurement at timestamp. Replay needs a valid
+	* snapshot at or before it; without one the measurement is retrodicted,
+	* whatever the mode.
+	* @return false, counting a late drop, when it is older than the oldest
+	* snapshot
+	*/
+	bool Prepare(double timestamp, Plan &plan) {
+		if (size_ == 0 || timestamp < at(0).timestamp) {
+			++late_drops_;
+			return false;
+		}
+		plan.from = -1;
+		for (int i = size_ - 1; i >= 0 && mode_ != RETRODICT; --i) {
+			if (at(i).timestamp <= timestamp && at(i).valid) {
+				plan.from = i;
+				break;
+			}
+		}
+		plan.steps = size_ - 1 - plan.from;
+		plan.replay = plan.from >= 0
+			&& (mode_ == REPLAY || plan.steps + 1 <= retrodict_cost_);
+		if (plan.replay) {
+			++replays_;
+			replayed_steps_ += plan.steps;
+		}
+		else
+			++retrodictions_;
+		return true;
+	}
+
+	/**
+	* Inserts meas after every snapshot at or before its timestamp and marks
+	* the snapshots after it stale, except the newest (the current state).
+	* A full history drops its oldest snapshot, which shifts plan.from down
+	* by one.
+	* @return the index of the new snapshot, or -1 when it would be older
+	* than everything held in a full history
+	*/
+	int Insert(const MeasurementView &meas, Plan &plan) {
+		int index = size_;
+		while (index > 0 && at(index - 1).timestamp > meas.timestamp_)
+			--index;
+		if (size_ == depth()) {
+			if (index == 0)
+				return -1;
+			head_ = (head_ + 1) % entries_.size();
+			--size_;
+			--index;
+			--plan.from;
+		}
+		for (int i = size_; i > index; --i)
+			at(i) = at(i - 1);
+		++size_;
+		Entry &entry = at(index);
+		entry.timestamp = meas.timestamp_;
+		entry.meas.Assign(meas);
+		entry.valid = false;
+		for (int i = index + 1; i < size_ - 1; ++i)
+			at(i).valid = false;
+		return index;
+	}
+
+	/**
+	* Stores the posterior for snapshot i and marks it valid
+	*/
+	void Store(int i, const StateVector &x, const StateMatrix &P) {
+		Entry &entry = at(i);
+		entry.x = x;
+		entry.P = P;
+		entry.valid = true;
+	}
+
+	///* late measurements handled by replay, and the steps replayed
+	long replays() const { return replays_; }
+	long replayedSteps() const { return replayed_steps_; }
+
+	///* late measurements handled by retrodiction
+	long retrodictions() const { return retrodictions_; }
+
+	///* late measurements older than the history, dropped
+	long lateDrops() const { return late_drops_; }
+
+private:
+	std::vector<Entry, Eigen::aligned_allocator<Entry> > entries_;
+	int head_;
+	int size_;
+	Mode mode_;
+	double retrodict_cost_;
+	long replays_;
+	long replayed_steps_;
+	long retrodictions_;
+	long late_drops_;
+};
+
+
+#endif //KF_KF_OOSM_H
@@ -0,0 +1,85 @@
+#ifndef KF_KF_PROPAGATE_H
+#define KF_KF_PROPAGATE_H
+
+
+#include "Eigen/Dense"
+
+/**
+ * Covariance propagation P = F*P*F^T for the transition matrices of the
+ * motion models, touching only their non-trivial blocks.
+ *
+ * The CV transition (KF_FUSION, EKF) is [I dt*I; 0 I] and the CTRV Jacobian
+ * (EKF_CTRV) is the identity outside rows 0-1 and its (3,4) entry, so most
+ * of the dense triple product multiplies by 0 or 1. The kernels below
+ * compute the upper triangle from the block formulas and mirror it, so the
+ * result is exactly symmetric. They agree with the dense product up to
+ * rounding; the filters keep the dense path behind a flag for
+ * cross-checking. Q is added by the caller.
+ */
+namespace kf_propagate {
+
+/**
+ * P = F*P*F^T for F = [I dt*I; 0 I], state (px, py, vx, vy)
+ */
+template <typename Scalar>
+inline void PropagateCV(Eigen::Matrix<Scalar, 4, 4> &P, Scalar dt) {
+	// position/velocity block: B' = B + dt*C
+	for (int i = 0; i < 2; ++i)
+		for (int j = 0; j < 2; ++j)
+			P(i, j + 2) += dt*P(i + 2, j + 2);
+	// position block: A' = A + dt*B^T + dt*B', B^T still in the lower left
+	for (int i = 0; i < 2; ++i)
+		for (int j = i; j < 2; ++j)
+			P(i, j) += dt*(P(i + 2, j) + P(i, j + 2));
+	P(1, 0) = P(0, 1);
+	for (int i = 0; i < 2; ++i)
+		for (int j = 0; j < 2; ++j)
+			P(j + 2, i) = P(i, j + 2);
+}
+
+/**
+ * P = JA*P*JA^T for the CTRV Jacobian, state (px, py, v, yaw, yaw rate):
+ * JA = [I G; 0 T] with G = JA(0:1, 2:4) and T the identity plus
+ * T(1,2) = JA(3,4)
+ */
+template <typename Scalar>
+inline void PropagateCTRV(Eigen::Matrix<Scalar, 5, 5> &P, const Eigen::Matrix<Scalar, 5, 5> &JA) {
+	const Scalar dt = JA(3, 4);
+
+	// rows 0-1 of JA*P: K = Ppp + G*Psp and N = Pps + G*Pss
+	Scalar K[2][2], N[2][3];
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 2; ++j)
+			K[i][j] = P(i, j) + JA(i, 2)*P(2, j) + JA(i, 3)*P(3, j) + JA(i, 4)*P(4, j);
+		for (int j = 0; j < 3; ++j)
+			N[i][j] = P(i, j + 2) + JA(i, 2)*P(2, j + 2) + JA(i, 3)*P(3, j + 2) + JA(i, 4)*P(4, j + 2);
+	}
+
+	// Ppp' = K + N*G^T, upper triangle
+	for (int i = 0; i < 2; ++i)
+		for (int j = i; j < 2; ++j)
+			P(i, j) = K[i][j] + N[i][0] * JA(j, 2) + N[i][1] * JA(j, 3) + N[i][2] * JA(j, 4);
+	P(1, 0) = P(0, 1);
+
+	// Pps' = N*T^T
+	for (int i = 0; i < 2; ++i) {
+		P(i, 2) = N[i][0];
+		P(i, 3) = N[i][1] + dt*N[i][2];
+		P(i, 4) = N[i][2];
+		P(2, i) = P(i, 2);
+		P(3, i) = P(i, 3);
+		P(4, i) = P(i, 4);
+	}
+
+	// Pss' = T*Pss*T^T: only row and column 3 change
+	const Scalar p23 = P(2, 3) + dt*P(2, 4);
+	const Scalar p34 = P(3, 4) + dt*P(4, 4);
+	P(3, 3) += dt*(P(4, 3) + p34);
+	P(2, 3) = P(3, 2) = p23;
+	P(3, 4) = P(4, 3) = p34;
+}
+
+} // namespace kf_propagate
+
+
+#endif //KF_KF_PROPAGATE_H
@@ -0,0 +1,37 @@
+#ifndef KF_KF_RADAR_H
+#define KF_KF_RADAR_H
+
+
+#include "Eigen/Dense"
+#include "kf_autodiff.h"
+#include "kf_models.h"
+
+/**
+ * Radar measurement model of the CV state (px, py, vx, vy):
+ * h(x) = (rho, phi, rho_dot) and its Jacobian H(x), computed together.
+ *
+ * Both come from one forward-mode pass over kf_models::CVRadar (see
+ * kf_autodiff.h) in fixed-size storage, in the state's own precision. A
+ * state too close to the sensor for the bearing to be defined is reported
+ * through the return value rather than printed, and the caller skips the
+ * update.
+ */
+namespace kf_radar {
+
+/**
+ * h(x) and H(x) for the CV radar model
+ * @return false, leaving h and H untouched, when px^2 + py^2 < 1e-4
+ */
+template <typename Scalar>
+inline bool MeasurementCV(const Eigen::Matrix<Scalar, 4, 1> &x,
+	Eigen::Matrix<Scalar, 3, 1> &h, Eigen::Matrix<Scalar, 3, 4> &H) {
+	if (x[0]*x[0] + x[1]*x[1] < Scalar(0.0001))
+		return false;
+	kf_autodiff::Jacobian(kf_models::CVRadar(), x, h, H);
+	return true;
+}
+
+}
+
+
+#endif //KF_KF_RADAR_H
@@ -0,0 +1,118 @@
+#ifndef KF_KF_SIGMA_POINTS_H
+#define KF_KF_SIGMA_POINTS_H
+
+
+#include "Eigen/Dense"
+#include <math.h>
+
+/**
+ * A sigma point set for an N-dimensional Gaussian: unit points u_i and
+ * weights w_i with sum w_i = 1, sum w_i*u_i = 0 and sum w_i*u_i*u_i^T = I.
+ * For a mean x and a covariance P = A*A^T the sigma points are
+ * x + A*u_i, and the weighted mean and covariance of their images under a
+ * function approximate those of the transformed distribution.
+ *
+ * Everything a set needs is computed once, when it is built; a filter only
+ * reads the unit points and weights. Any points and weights meeting the
+ * conditions above can be plugged in through the constructor; the
+ * factories give the usual sets:
+ *   Julier    2N+1 points: the centre and +-sqrt(N+lambda) along each axis
+ *   Simplex   N+2 points: the spherical simplex set (Julier 2003), the
+ *             fewest points with a centre that match the covariance
+ *   Cubature  2N points: +-sqrt(N) along each axis, all weights 1/2N
+ * Symmetric sets, an optional centre and +-spread along each axis, are
+ * flagged (spread() > 0) so that the points can be written without the
+ * product A*u_i.
+ */
+template <int N>
+class SigmaPointSet {
+public:
+	enum { MAX_POINTS = 2 * N + 1 };
+	typedef Eigen::Matrix<double, N, Eigen::Dynamic, 0, N, MAX_POINTS> PointMatrix;
+	typedef Eigen::Matrix<double, Eigen::Dynamic, 1, 0, MAX_POINTS, 1> WeightVector;
+
+	/**
+	 * @param name Label for reports
+	 * @param unit Unit points, one per column, at most MAX_POINTS
+	 * @param weights One weight per point
+	 * @param spread For symmetric sets: the distance of the axis points
+	 * from the centre, 0 otherwise
+	 * @param centred For symmetric sets: whether column 0 is the centre
+	 */
+	SigmaPointSet(const char *name, const PointMatrix &unit, const WeightVector &weights,
+		double spread = 0, bool centred = false)
+		: name_(name), unit_(unit), weights_(weights), spread_(spread), centred_(centred) {}
+
+	/**
+	 * The 2N+1 point set with the given lambda: weights lambda/(N+lambda)
+	 * at the centre and 1/(2(N+lambda)) elsewhere
+	 */
+	static SigmaPointSet Julier(double lambda) {
+		const double spread = sqrt(N + lambda);
+		PointMatrix unit = PointMatrix::Zero(N, 2 * N + 1);
+		WeightVector weights = WeightVector::Constant(2 * N + 1, 0.5 / (N + lambda));
+		weights[0] = lambda / (N + lambda);
+		for (int i = 0; i < N; ++i) {
+			unit(i, 1 + i) = spread;
+			unit(i, 1 + N + i) = -spread;
+		}
+		return SigmaPointSet("Julier", unit, weights, spread, true);
+	}
+
+	/**
+	 * The N+2 point spherical simplex set with centre weight w0 in [0, 1);
+	 * the other points share 1 - w0 equally and lie on a sphere of radius
+	 * sqrt(N/(1 - w0)). The default gives every point the same weight.
+	 */
+	static SigmaPointSet Simplex(double w0 = 1.0 / (N + 2)) {
+		const double w = (1 - w0) / (N + 1);
+		PointMatrix unit = PointMatrix::Zero(N, N + 2);
+		WeightVector weights = WeightVector::Constant(N + 2, w);
+		weights[0] = w0;
+		// built up one dimension at a time: for dimension j the points
+		// 1..j keep their coordinates and get -1/sqrt(j(j+1)w) in the new
+		// one, and point j+1 is j/sqrt(j(j+1)w) along the new axis alone
+		unit(0, 1) = -1 / sqrt(2 * w);
+		unit(0, 2) = 1 / sqrt(2 * w);
+		for (int j = 2; j <= N; ++j) {
+			const double s = 1 / sqrt(j * (j + 1) * w);
+			for (int i = 1; i <= j; ++i)
+				unit(j - 1, i) = -s;
+			unit(j - 1, j + 1) = j * s;
+		}
+		return SigmaPointSet("spherical simplex", unit, weights);
+	}
+
+	/**
+	 * The 2N point third-degree cubature set: all weights positive
+	 */
+	static SigmaPointSet Cubature() {
+		const double spread = sqrt(double(N));
+		PointMatrix unit = PointMatrix::Zero(N, 2 * N);
+		const WeightVector weights = WeightVector::Constant(2 * N, 0.5 / N);
+		for (int i = 0; i < N; ++i) {
+			unit(i, i) = spread;
+			unit(i, N + i) = -spread;
+		}
+		return SigmaPointSet("cubature", unit, weights, spread, false);
+	}
+
+	const char *name() const { return name_; }
+	int size() const { return int(unit_.cols()); }
+	const PointMatrix &unit() const { return unit_; }
+	const WeightVector &weights() const { return weights_; }
+	double spread() const { return spread_; }
+	bool centred() const { return centred_; }
+
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+private:
+	const char *name_;
+	PointMatrix unit_;
+	WeightVector weights_;
+	double spread_;
+	bool centred_;
+};
+
+
+#endif //KF_KF_SIGMA_POINTS_H
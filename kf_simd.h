@@ -0,0 +1,96 @@
+#ifndef KF_KF_SIMD_H
+#define KF_KF_SIMD_H
+
+#if defined(__AVX2__) || defined(__AVX512F__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Thin SIMD lane types for the structure-of-arrays filter kernels.
+ *
+ * Each type wraps one register of doubles and provides Load/Store/Set and
+ * the arithmetic operators, so a kernel written once as a template over the
+ * lane type runs on AVX-512 (8 lanes), AVX2 (4), SSE2 (2) or plain scalar
+ * code. The widest type enabled by the compiler flags is LaneWide; build
+ * with -DKF_NATIVE=ON to get AVX2/AVX-512 on hosts that have them.
+ * Loads and stores are unaligned, so arrays only need natural alignment.
+ */
+namespace kf_simd {
+
+struct LaneScalar {
+	enum { Width = 1 };
+	double v;
+	static LaneScalar Load(const double *p) { LaneScalar r; r.v = *p; return r; }
+	static LaneScalar Set(double s) { LaneScalar r; r.v = s; return r; }
+	void Store(double *p) const { *p = v; }
+};
+inline LaneScalar operator+(LaneScalar a, LaneScalar b) { a.v += b.v; return a; }
+inline LaneScalar operator-(LaneScalar a, LaneScalar b) { a.v -= b.v; return a; }
+inline LaneScalar operator*(LaneScalar a, LaneScalar b) { a.v *= b.v; return a; }
+inline LaneScalar operator/(LaneScalar a, LaneScalar b) { a.v /= b.v; return a; }
+
+#if defined(__SSE2__)
+struct LaneSSE2 {
+	enum { Width = 2 };
+	__m128d v;
+	static LaneSSE2 Load(const double *p) { LaneSSE2 r; r.v = _mm_loadu_pd(p); return r; }
+	static LaneSSE2 Set(double s) { LaneSSE2 r; r.v = _mm_set1_pd(s); return r; }
+	void Store(double *p) const { _mm_storeu_pd(p, v); }
+};
+inline LaneSSE2 operator+(LaneSSE2 a, LaneSSE2 b) { a.v = _mm_add_pd(a.v, b.v); return a; }
+inline LaneSSE2 operator-(LaneSSE2 a, LaneSSE2 b) { a.v = _mm_sub_pd(a.v, b.v); return a; }
+inline LaneSSE2 operator*(LaneSSE2 a, LaneSSE2 b) { a.v = _mm_mul_pd(a.v, b.v); return a; }
+inline LaneSSE2 operator/(LaneSSE2 a, LaneSSE2 b) { a.v = _mm_div_pd(a.v, b.v); return a; }
+#endif
+
+#if defined(__AVX2__)
+struct LaneAVX2 {
+	enum { Width = 4 };
+	__m256d v;
+	static LaneAVX2 Load(const double *p) { LaneAVX2 r; r.v = _mm256_loadu_pd(p); return r; }
+	static LaneAVX2 Set(double s) { LaneAVX2 r; r.v = _mm256_set1_pd(s); return r; }
+	void Store(double *p) const { _mm256_storeu_pd(p, v); }
+};
+inline LaneAVX2 operator+(LaneAVX2 a, LaneAVX2 b) { a.v = _mm256_add_pd(a.v, b.v); return a; }
+inline LaneAVX2 operator-(LaneAVX2 a, LaneAVX2 b) { a.v = _mm256_sub_pd(a.v, b.v); return a; }
+inline LaneAVX2 operator*(LaneAVX2 a, LaneAVX2 b) { a.v = _mm256_mul_pd(a.v, b.v); return a; }
+inline LaneAVX2 operator/(LaneAVX2 a, LaneAVX2 b) { a.v = _mm256_div_pd(a.v, b.v); return a; }
+#endif
+
+#if defined(__AVX512F__)
+struct LaneAVX512 {
+	enum { Width = 8 };
+	__m512d v;
+	static LaneAVX512 Load(const double *p) { LaneAVX512 r; r.v = _mm512_loadu_pd(p); return r; }
+	static LaneAVX512 Set(double s) { LaneAVX512 r; r.v = _mm512_set1_pd(s); return r; }
+	void Store(double *p) const { _mm512_storeu_pd(p, v); }
+};
+inline LaneAVX512 operator+(LaneAVX512 a, LaneAVX512 b) { a.v = _mm512_add_pd(a.v, b.v); return a; }
+inline LaneAVX512 operator-(LaneAVX512 a, LaneAVX512 b) { a.v = _mm512_sub_pd(a.v, b.v); return a; }
+inline LaneAVX512 operator*(LaneAVX512 a, LaneAVX512 b) { a.v = _mm512_mul_pd(a.v, b.v); return a; }
+inline LaneAVX512 operator/(LaneAVX512 a, LaneAVX512 b) { a.v = _mm512_div_pd(a.v, b.v); return a; }
+typedef LaneAVX512 LaneWide;
+#define KF_SIMD_LANE_NAME "AVX-512"
+#elif defined(__AVX2__)
+typedef LaneAVX2 LaneWide;
+#define KF_SIMD_LANE_NAME "AVX2"
+#elif defined(__SSE2__)
+typedef LaneSSE2 LaneWide;
+#define KF_SIMD_LANE_NAME "SSE2"
+#else
+typedef LaneScalar LaneWide;
+#define KF_SIMD_LANE_NAME "scalar"
+#endif
+
+/**
+ * s in every lane of V; plain double passes through, so kernels templated
+ * on the lane type also run on scalars
+ */
+template <typename V>
+inline V Broadcast(double s) { return V::Set(s); }
+template <>
+inline double Broadcast<double>(double s) { return s; }
+
+} // namespace kf_simd
+
+#endif //KF_KF_SIMD_H
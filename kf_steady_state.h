@@ -0,0 +1,92 @@
+#ifndef KF_KF_STEADY_STATE_H
+#define KF_KF_STEADY_STATE_H
+
+
+#include "Eigen/Dense"
+#include "kf_update.h"
+
+/**
+ * Steady-state solution of a time-invariant linear filter.
+ *
+ * With constant F, Q, H and R the covariance of a Kalman filter converges
+ * to the fixed point of the Riccati recursion (the discrete algebraic
+ * Riccati equation), and the gain with it. Solve() iterates the recursion
+ * until the posterior covariance stops changing and keeps the limits K
+ * and P. A filter that has converged can then replace predict + update by
+ * x = F*x; x += K*(z - H*x) and skip the covariance entirely.
+ *
+ * The caller owns the key: the solution is only valid for the F, Q, H and
+ * R it was solved with.
+ */
+template <int NX, int NZ, typename Scalar = double>
+class SteadyStateGain {
+public:
+	typedef Eigen::Matrix<Scalar, NX, NX> StateMatrix;
+	typedef Eigen::Matrix<Scalar, NX, NZ> GainMatrix;
+
+	SteadyStateGain() : valid_(false), iterations_(0) {
+		K_.setZero();
+		P_.setZero();
+	}
+
+	/**
+	* Iterates predict + update from the posterior P0 until the posterior
+	* changes by less than tolerance relative to its largest element
+	* @return true on convergence; K() and P() are only valid then
+	*/
+	bool Solve(const StateMatrix &F, const StateMatrix &Q,
+		const Eigen::Matrix<Scalar, NZ, NX> &H, const Eigen::Matrix<Scalar, NZ, NZ> &R,
+		const StateMatrix &P0, int max_iterations = 10000, Scalar tolerance = Scalar(1e-12)) {
+		valid_ = false;
+		StateMatrix P = P0;
+		for (iterations_ = 1; iterations_ <= max_iterations; ++iterations_) {
+			StateMatrix prior = F*P*F.transpose() + Q;
+			Eigen::Matrix<Scalar, NX, NZ> PHT = prior*H.transpose();
+			Eigen::Matrix<Scalar, NZ, NZ> S = H*PHT + R;
+			if (!kf_update::SolveGain(S, PHT, K_))
+				return false;
+			kf_update::UpdateCovariance(prior, K_, H, S, R, kf_update::JOSEPH_UPDATE);
+			const Scalar change = (prior - P).cwiseAbs().maxCoeff();
+			P = prior;
+			if (change <= tolerance*P.cwiseAbs().maxCoeff()) {
+				P_ = P;
+				valid_ = true;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/**
+	* True when P is within tolerance (relative to its largest element) of
+	* the steady-state posterior, i.e. the filter's own gain has converged
+	*/
+	bool IsConverged(const StateMatrix &P, Scalar tolerance) const {
+		return valid_ && (P - P_).cwiseAbs().maxCoeff() <= tolerance*P_.cwiseAbs().maxCoeff();
+	}
+
+	void Invalidate() { valid_ = false; }
+
+	bool valid() const { return valid_; }
+
+	///* steady-state gain
+	const GainMatrix &K() const { return K_; }
+
+	///* steady-state posterior covariance
+	const StateMatrix &P() const { return P_; }
+
+	///* iterations taken by the last Solve()
+	int iterations() const { return iterations_; }
+
+private:
+	bool valid_;
+	int iterations_;
+	GainMatrix K_;
+	StateMatrix P_;
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+#endif //KF_KF_STEADY_STATE_H
@@ -0,0 +1,212 @@
+#ifndef KF_KF_SYM_PACKED_H
+#define KF_KF_SYM_PACKED_H
+
+
+#include "Eigen/Dense"
+#include "kf_simd.h"
+#include "kf_update.h"
+
+/**
+ * Packed storage of an N x N symmetric matrix: the upper triangle, row by
+ * row, N*(N+1)/2 values (10 for the 4-state CV model, 15 for CTRV).
+ *
+ * Each off-diagonal element is stored once, so a covariance kept in this
+ * form is symmetric by construction and takes 10/16 (CV) or 15/25 (CTRV)
+ * of the memory of the dense matrix. The kernels in kf_packed work on the
+ * packed values directly; they are templates over the element type, so the
+ * same code runs on one SymPacked (double) and on the SIMD lanes of a
+ * structure-of-arrays bank (see KFBank).
+ */
+template <int N, typename Scalar = double>
+class SymPacked {
+public:
+	enum { Size = N*(N + 1) / 2 };
+	typedef Eigen::Matrix<Scalar, N, N> DenseMatrix;
+
+	SymPacked() {}
+
+	/**
+	* Packs the upper triangle of P
+	*/
+	explicit SymPacked(const DenseMatrix &P) { FromDense(P); }
+
+	/**
+	* Offset of element (i, j), either triangle
+	*/
+	static int Index(int i, int j) {
+		const int r = i < j ? i : j;
+		const int c = i < j ? j : i;
+		return r*N - r*(r - 1) / 2 + c - r;
+	}
+
+	Scalar &operator()(int i, int j) { return a_[Index(i, j)]; }
+	const Scalar &operator()(int i, int j) const { return a_[Index(i, j)]; }
+
+	Scalar *data() { return a_; }
+	const Scalar *data() const { return a_; }
+
+	void FromDense(const DenseMatrix &P) {
+		for (int i = 0; i < N; ++i)
+			for (int j = i; j < N; ++j)
+				a_[Index(i, j)] = P(i, j);
+	}
+
+	DenseMatrix ToDense() const {
+		DenseMatrix P;
+		for (int i = 0; i < N; ++i)
+			for (int j = i; j < N; ++j)
+				P(i, j) = P(j, i) = a_[Index(i, j)];
+		return P;
+	}
+
+	SymPacked &operator+=(const SymPacked &other) {
+		for (int k = 0; k < Size; ++k)
+			a_[k] += other.a_[k];
+		return *this;
+	}
+
+private:
+	Scalar a_[Size];
+};
+
+namespace kf_packed {
+
+/**
+ * P = F*P*F^T for F = [I dt*I; 0 I] on a packed 4x4 P, state (px, py, vx, vy).
+ * Same block formulas as kf_propagate::PropagateCV.
+ */
+template <typename T>
+inline void PropagateCV(T *P, T dt) {
+	typedef SymPacked<4> Layout;
+	// position/velocity block B, velocity block C
+	T b[2][2], c[2][2];
+	for (int i = 0; i < 2; ++i)
+		for (int j = 0; j < 2; ++j) {
+			b[i][j] = P[Layout::Index(i, j + 2)];
+			c[i][j] = P[Layout::Index(i + 2, j + 2)];
+		}
+	// B' = B + dt*C, A' = A + dt*(B^T + B')
+	for (int i = 0; i < 2; ++i)
+		for (int j = 0; j < 2; ++j) {
+			T nb = b[i][j] + dt*c[i][j];
+			P[Layout::Index(i, j + 2)] = nb;
+			if (j >= i)
+				P[Layout::Index(i, j)] = P[Layout::Index(i, j)] + dt*(b[j][i] + nb);
+		}
+}
+
+/**
+ * P = JA*P*JA^T on a packed 5x5 P for the CTRV Jacobian
+ * JA = [I G; 0 T], T the identity plus T(1,2) = dt.
+ * Same block formulas as kf_propagate::PropagateCTRV.
+ * @param G Row-major 2x3 block JA(0:1, 2:4)
+ * @param dt JA(3,4)
+ */
+template <typename T>
+inline void PropagateCTRV(T *P, const T *G, T dt) {
+	typedef SymPacked<5> Layout;
+	// rows 0-1 of JA*P: K = Ppp + G*Psp, M = Pps + G*Pss
+	T K[2][2], M[2][3];
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 2; ++j)
+			K[i][j] = P[Layout::Index(i, j)] + G[3 * i] * P[Layout::Index(2, j)]
+			+ G[3 * i + 1] * P[Layout::Index(3, j)] + G[3 * i + 2] * P[Layout::Index(4, j)];
+		for (int j = 0; j < 3; ++j)
+			M[i][j] = P[Layout::Index(i, j + 2)] + G[3 * i] * P[Layout::Index(2, j + 2)]
+			+ G[3 * i + 1] * P[Layout::Index(3, j + 2)] + G[3 * i + 2] * P[Layout::Index(4, j + 2)];
+	}
+	// Ppp' = K + M*G^T
+	for (int i = 0; i < 2; ++i)
+		for (int j = i; j < 2; ++j)
+			P[Layout::Index(i, j)] = K[i][j] + M[i][0] * G[3 * j] + M[i][1] * G[3 * j + 1] + M[i][2] * G[3 * j + 2];
+	// Pps' = M*T^T
+	for (int i = 0; i < 2; ++i) {
+		P[Layout::Index(i, 2)] = M[i][0];
+		P[Layout::Index(i, 3)] = M[i][1] + dt*M[i][2];
+		P[Layout::Index(i, 4)] = M[i][2];
+	}
+	// Pss' = T*Pss*T^T
+	const T p34 = P[Layout::Index(3, 4)] + dt*P[Layout::Index(4, 4)];
+	P[Layout::Index(3, 3)] = P[Layout::Index(3, 3)] + dt*(P[Layout::Index(3, 4)] + p34);
+	P[Layout::Index(2, 3)] = P[Layout::Index(2, 3)] + dt*P[Layout::Index(2, 4)];
+	P[Layout::Index(3, 4)] = p34;
+}
+
+/**
+ * Update with a direct measurement of states 0 and 1 (H = [I 0], lidar)
+ * and diagonal R, on a packed N x N P. Only the upper triangle is written,
+ * P -= P*H^T * S^-1 * H*P, so P stays symmetric.
+ * @param x State, updated in place
+ * @param y0, y1 Innovation z - H*x
+ * @param r0, r1 Diagonal of R
+ */
+template <int N, typename T>
+inline void UpdatePosition(T *x, T *P, T y0, T y1, T r0, T r1) {
+	typedef SymPacked<N> Layout;
+	// P*H^T: columns 0 and 1 of P
+	T ph0[N], ph1[N];
+	for (int i = 0; i < N; ++i) {
+		ph0[i] = P[Layout::Index(i, 0)];
+		ph1[i] = P[Layout::Index(i, 1)];
+	}
+	const T s00 = ph0[0] + r0;
+	const T s01 = ph1[0];
+	const T s11 = ph1[1] + r1;
+	const T inv_det = kf_simd::Broadcast<T>(1.0) / (s00*s11 - s01*s01);
+
+	for (int i = 0; i < N; ++i) {
+		const T k0 = (ph0[i] * s11 - ph1[i] * s01)*inv_det;
+		const T k1 = (ph1[i] * s00 - ph0[i] * s01)*inv_det;
+		x[i] = x[i] + k0*y0 + k1*y1;
+		for (int j = i; j < N; ++j)
+			P[Layout::Index(i, j)] = P[Layout::Index(i, j)] - k0*ph0[j] - k1*ph1[j];
+	}
+}
+
+/**
+ * Linear or EKF update on a packed P with a fixed-size measurement model.
+ * Uses kf_update::SolveGain for K and writes only the upper triangle of
+ * P -= K*(P*H^T)^T.
+ * @param x State, updated in place
+ * @param y Innovation z - h(x)
+ * @param H Measurement matrix or Jacobian
+ * @param R Measurement covariance
+ * @return false if S is not positive definite; x and P are then unchanged
+ */
+template <int N, int NZ, typename Scalar>
+inline bool Update(Eigen::Matrix<Scalar, N, 1> &x, SymPacked<N, Scalar> &P,
+	const Eigen::Matrix<Scalar, NZ, 1> &y, const Eigen::Matrix<Scalar, NZ, N> &H,
+	const Eigen::Matrix<Scalar, NZ, NZ> &R) {
+	const Eigen::Matrix<Scalar, N, NZ> PHT = P.ToDense()*H.transpose();
+	const Eigen::Matrix<Scalar, NZ, NZ> S = H*PHT + R;
+	Eigen::Matrix<Scalar, N, NZ> K;
+	if (!kf_update::SolveGain(S, PHT, K))
+		return false;
+	x += K*y;
+	for (int i = 0; i < N; ++i)
+		for (int j = i; j < N; ++j)
+			P(i, j) -= K.row(i).dot(PHT.row(j));
+	return true;
+}
+
+/**
+ * PropagateCV on a SymPacked object
+ */
+template <typename Scalar>
+inline void PropagateCV(SymPacked<4, Scalar> &P, Scalar dt) {
+	PropagateCV(P.data(), dt);
+}
+
+/**
+ * PropagateCTRV on a SymPacked object, G and dt taken from JA
+ */
+template <typename Scalar>
+inline void PropagateCTRV(SymPacked<5, Scalar> &P, const Eigen::Matrix<Scalar, 5, 5> &JA) {
+	const Scalar G[6] = { JA(0, 2), JA(0, 3), JA(0, 4), JA(1, 2), JA(1, 3), JA(1, 4) };
+	PropagateCTRV(P.data(), G, JA(3, 4));
+}
+
+} // namespace kf_packed
+
+
+#endif //KF_KF_SYM_PACKED_H
@@ -0,0 +1,73 @@
+#include "kf_transition_cache.h"
+
+CVTransitionCache::CVTransitionCache(float noise_ax2, float noise_ay2)
+	: noise_ax2_(noise_ax2), noise_ay2_(noise_ay2), hits_(0), misses_(0) {
+	for (int i = 0; i < Slots; ++i) {
+		slots_[i].state.store(EMPTY, std::memory_order_relaxed);
+		slots_[i].key = 0;
+	}
+}
+
+void CVTransitionCache::Compute(double delta_t, float noise_ax2, float noise_ay2, Entry &entry) {
+	// same float intermediates as the filters used to compute inline
+	float delta_t2 = delta_t*delta_t;
+	float delta_t3 = delta_t2*delta_t;
+	float delta_t4 = delta_t3*delta_t;
+	entry.F.setIdentity();
+	entry.F(0, 2) = delta_t;
+	entry.F(1, 3) = delta_t;
+	entry.Q << delta_t4 / 4 * noise_ax2, 0, delta_t3 / 2 * noise_ax2, 0,
+		0, delta_t4 / 4 * noise_ay2, 0, delta_t3 / 2 * noise_ay2,
+		delta_t3 / 2 * noise_ax2, 0, delta_t2*noise_ax2, 0,
+		0, delta_t3 / 2 * noise_ay2, 0, delta_t2*noise_ay2;
+}
+
+const CVTransitionCache::Entry &CVTransitionCache::Lookup(double delta_t, Entry &scratch) {
+	// only whole microseconds are cached, so a hit always stands for the
+	// exact delta_t it was computed from
+	const long long key = delta_t > 0 ? (long long)(delta_t*1000000.0 + 0.5) : 0;
+	if (key <= 0 || double(key) / 1000000.0 != delta_t) {
+		misses_.fetch_add(1, std::memory_order_relaxed);
+		Compute(delta_t, noise_ax2_, noise_ay2_, scratch);
+		return scratch;
+	}
+
+	const int home = int(key % Slots);
+	for (int probe = 0; probe < Probes; ++probe) {
+		Slot &slot = slots_[(home + probe) % Slots];
+		int state = slot.state.load(std::memory_order_acquire);
+		if (state == READY) {
+			if (slot.key == key) {
+				hits_.fetch_add(1, std::memory_order_relaxed);
+				return slot.entry;
+			}
+			continue;
+		}
+		if (state == EMPTY && slot.state.compare_exchange_strong(state, WRITING,
+			std::memory_order_acquire, std::memory_order_relaxed)) {
+			misses_.fetch_add(1, std::memory_order_relaxed);
+			slot.key = key;
+			Compute(delta_t, noise_ax2_, noise_ay2_, slot.entry);
+			slot.state.store(READY, std::memory_order_release);
+			return slot.entry;
+		}
+		// another thread is filling this slot; don't wait for it
+		break;
+	}
+	misses_.fetch_add(1, std::memory_order_relaxed);
+	Compute(delta_t, noise_ax2_, noise_ay2_, scratch);
+	return scratch;
+}
+
+int CVTransitionCache::size() const {
+	int n = 0;
+	for (int i = 0; i < Slots; ++i)
+		if (slots_[i].state.load(std::memory_order_acquire) == READY)
+			++n;
+	return n;
+}
+
+CVTransitionCache &CVTransitionCache::Default() {
+	static CVTransitionCache cache(kCVNoiseVariance, kCVNoiseVariance);
+	return cache;
+}
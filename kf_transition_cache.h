@@ -0,0 +1,90 @@
+#ifndef KF_KF_TRANSITION_CACHE_H
+#define KF_KF_TRANSITION_CACHE_H
+
+
+#include "Eigen/Dense"
+#include <atomic>
+
+/**
+ * Acceleration noise variance of the constant-velocity model, on both
+ * axes, in KF_FUSION, EKF and CVTransitionCache::Default()
+ */
+const float kCVNoiseVariance = 9.0f;
+
+/**
+ * Bounded cache of the constant-velocity transition F(dt) and process
+ * noise Q(dt) used by KF_FUSION and EKF, keyed by dt in microseconds.
+ *
+ * Sensors run at a few fixed intervals (50 ms, 100 ms and multiples when
+ * frames drop), so the same handful of F/Q pairs is rebuilt over and over.
+ * The cache holds up to Slots entries. An entry is written once, by the
+ * first thread that misses on its key, and is read-only afterwards, so any
+ * number of filters (and threads) can share one cache without locking.
+ * When the probed slots are all taken by other intervals, or dt is not a
+ * whole number of microseconds, Lookup() computes into the caller's scratch
+ * entry instead. Cached and computed entries are bitwise identical.
+ */
+class CVTransitionCache {
+public:
+	enum { Slots = 64 };
+
+	struct Entry {
+		Eigen::Matrix4d F;
+		Eigen::Matrix4d Q;
+
+		EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+	};
+
+	/**
+	* @param noise_ax2, noise_ay2 Acceleration noise variances of the model
+	*/
+	CVTransitionCache(float noise_ax2, float noise_ay2);
+
+	/**
+	* F and Q for delta_t (seconds). Returns the cached entry, or fills and
+	* returns scratch when dt cannot be cached.
+	*/
+	const Entry &Lookup(double delta_t, Entry &scratch);
+
+	/**
+	* Builds F and Q for delta_t without a cache
+	*/
+	static void Compute(double delta_t, float noise_ax2, float noise_ay2, Entry &entry);
+
+	long hits() const { return hits_.load(std::memory_order_relaxed); }
+	long misses() const { return misses_.load(std::memory_order_relaxed); }
+
+	///* number of intervals currently cached
+	int size() const;
+
+	/**
+	* Cache shared by KF_FUSION and EKF (kCVNoiseVariance on both axes)
+	*/
+	static CVTransitionCache &Default();
+
+private:
+	enum SlotState { EMPTY, WRITING, READY };
+	// slots probed after the home slot of a key
+	enum { Probes = 8 };
+
+	struct Slot {
+		std::atomic<int> state;
+		long long key;
+		Entry entry;
+	};
+
+	float noise_ax2_;
+	float noise_ay2_;
+	Slot slots_[Slots];
+	std::atomic<long> hits_;
+	std::atomic<long> misses_;
+
+	CVTransitionCache(const CVTransitionCache &);
+	CVTransitionCache &operator=(const CVTransitionCache &);
+
+public:
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+};
+
+
+#endif //KF_KF_TRANSITION_CACHE_H
@@ -0,0 +1,371 @@
+#ifndef KF_KF_UPDATE_H
+#define KF_KF_UPDATE_H
+
+
+#include "Eigen/Dense"
+
+/**
+ * Kalman gain kernel shared by KF, KF_FIXED, EKF_CTRV and UKF.
+ *
+ * Every filter forms its gain as K = PHT * S^-1, where S is the innovation
+ * covariance (symmetric positive definite) and PHT is the state/measurement
+ * cross covariance (P*H^T for the linearised filters, Tc for the UKF).
+ * SolveGain() computes K without an explicit inverse: 2x2 and 3x3 S (lidar
+ * and radar) use a closed-form symmetric adjugate, 4x4 (cartesian radar)
+ * eliminates 2x2 blocks, anything else a Cholesky solve with an LDLT
+ * fallback for nearly semi-definite S.
+ * Only the lower triangle of S is read.
+ *
+ * All functions return false, and leave K untouched, when S is not
+ * positive definite; callers should then skip the update.
+ *
+ * SequentialUpdate() is the alternative for diagonal R: the measurement
+ * components are independent, so they can be applied one scalar update at a
+ * time with no matrix solve at all.
+ *
+ * Once K is known, UpdateCovariance() applies one of the CovarianceUpdate
+ * forms to P; the symmetric and Joseph forms write the upper triangle and
+ * mirror it, so P never drifts away from symmetry.
+ */
+namespace kf_update {
+
+/**
+ * K = PHT * S^-1 for a 2x2 S
+ */
+template <typename DerivedS, typename DerivedB, typename DerivedK>
+inline bool SolveGain2x2(const Eigen::MatrixBase<DerivedS> &S,
+	const Eigen::MatrixBase<DerivedB> &PHT, Eigen::MatrixBase<DerivedK> &K) {
+	typedef typename DerivedS::Scalar Scalar;
+	const Scalar a = S(0, 0), b = S(1, 0), c = S(1, 1);
+	const Scalar det = a*c - b*b;
+	if (!(a > 0) || !(det > 0))
+		return false;
+	const Scalar inv_det = Scalar(1) / det;
+	for (int i = 0; i < PHT.rows(); ++i) {
+		const Scalar p0 = PHT(i, 0), p1 = PHT(i, 1);
+		K(i, 0) = (c*p0 - b*p1)*inv_det;
+		K(i, 1) = (a*p1 - b*p0)*inv_det;
+	}
+	return true;
+}
+
+/**
+ * K = PHT * S^-1 for a 3x3 S
+ */
+template <typename DerivedS, typename DerivedB, typename DerivedK>
+inline bool SolveGain3x3(const Eigen::MatrixBase<DerivedS> &S,
+	const Eigen::MatrixBase<DerivedB> &PHT, Eigen::MatrixBase<DerivedK> &K) {
+	typedef typename DerivedS::Scalar Scalar;
+	const Scalar a = S(0, 0), b = S(1, 0), c = S(2, 0);
+	const Scalar d = S(1, 1), e = S(2, 1), f = S(2, 2);
+	// cofactors of the symmetric matrix [a b c; b d e; c e f]
+	const Scalar A00 = d*f - e*e;
+	const Scalar A01 = c*e - b*f;
+	const Scalar A02 = b*e - c*d;
+	const Scalar A11 = a*f - c*c;
+	const Scalar A12 = b*c - a*e;
+	const Scalar A22 = a*d - b*b;
+	const Scalar det = a*A00 + b*A01 + c*A02;
+	// Sylvester's criterion on the leading minors
+	if (!(a > 0) || !(A22 > 0) || !(det > 0))
+		return false;
+	const Scalar inv_det = Scalar(1) / det;
+	for (int i = 0; i < PHT.rows(); ++i) {
+		const Scalar p0 = PHT(i, 0), p1 = PHT(i, 1), p2 = PHT(i, 2);
+		K(i, 0) = (p0*A00 + p1*A01 + p2*A02)*inv_det;
+		K(i, 1) = (p0*A01 + p1*A11 + p2*A12)*inv_det;
+		K(i, 2) = (p0*A02 + p1*A12 + p2*A22)*inv_det;
+	}
+	return true;
+}
+
+/**
+ * K = PHT * S^-1 for a 4x4 S, by block elimination on its 2x2 blocks
+ * S = [A B; B^T C] with the Schur complement X = C - B^T*A^-1*B
+ */
+template <typename Scalar, int NX>
+inline bool SolveGain4x4(const Eigen::Matrix<Scalar, 4, 4> &S,
+	const Eigen::Matrix<Scalar, NX, 4> &PHT, Eigen::Matrix<Scalar, NX, 4> &K) {
+	const Eigen::Matrix<Scalar, 2, 2> A = S.template topLeftCorner<2, 2>();
+	const Eigen::Matrix<Scalar, 2, 2> B = S.template bottomLeftCorner<2, 2>().transpose();
+	// M = B^T * A^-1
+	Eigen::Matrix<Scalar, 2, 2> M;
+	if (!SolveGain2x2(A, B.transpose(), M))
+		return false;
+	const Eigen::Matrix<Scalar, 2, 2> X = S.template bottomRightCorner<2, 2>() - M*B;
+	const Eigen::Matrix<Scalar, NX, 2> P1 = PHT.template leftCols<2>();
+	const Eigen::Matrix<Scalar, NX, 2> Y = PHT.template rightCols<2>() - P1*M.transpose();
+	Eigen::Matrix<Scalar, NX, 2> K2;
+	if (!SolveGain2x2(X, Y, K2))
+		return false;
+	const Eigen::Matrix<Scalar, NX, 2> Z = P1 - K2*B.transpose();
+	Eigen::Matrix<Scalar, NX, 2> K1;
+	SolveGain2x2(A, Z, K1);
+	K.template leftCols<2>() = K1;
+	K.template rightCols<2>() = K2;
+	return true;
+}
+
+/**
+ * K = PHT * S^-1 through a Cholesky solve, falling back to LDLT when the
+ * LLT breaks down. The decompositions are passed in so that callers with a
+ * dynamic-size workspace can reuse their storage.
+ */
+template <typename MatrixS, typename DerivedB, typename DerivedK>
+inline bool SolveGainCholesky(const MatrixS &S, const Eigen::MatrixBase<DerivedB> &PHT,
+	Eigen::MatrixBase<DerivedK> &K, Eigen::LLT<MatrixS> &llt, Eigen::LDLT<MatrixS> &ldlt) {
+	llt.compute(S);
+	if (llt.info() == Eigen::Success) {
+		K.transpose() = llt.solve(PHT.transpose());
+		return true;
+	}
+	ldlt.compute(S);
+	if (ldlt.info() == Eigen::Success && ldlt.isPositive() &&
+		ldlt.vectorD().minCoeff() > 0) {
+		K.transpose() = ldlt.solve(PHT.transpose());
+		return true;
+	}
+	return false;
+}
+
+/**
+ * K = PHT * S^-1 for fixed-size S via a square-root-free Cholesky
+ * factorisation S = L*D*L^T. The factorisation and both triangular solves
+ * are written out over the columns of K so the compiler can unroll them.
+ * Falls back to Eigen's LLT/LDLT when a pivot is not positive.
+ */
+template <typename Scalar, int NX, int NZ>
+inline bool SolveGainCholesky(const Eigen::Matrix<Scalar, NZ, NZ> &S,
+	const Eigen::Matrix<Scalar, NX, NZ> &PHT, Eigen::Matrix<Scalar, NX, NZ> &K) {
+	Scalar L[NZ][NZ];
+	Scalar D[NZ];
+	Scalar inv_D[NZ];
+	for (int j = 0; j < NZ; ++j) {
+		Scalar LD[NZ];
+		Scalar d = S(j, j);
+		for (int k = 0; k < j; ++k) {
+			LD[k] = L[j][k]*D[k];
+			d -= LD[k]*L[j][k];
+		}
+		if (!(d > 0)) {
+			Eigen::LLT<Eigen::Matrix<Scalar, NZ, NZ> > llt;
+			Eigen::LDLT<Eigen::Matrix<Scalar, NZ, NZ> > ldlt;
+			return SolveGainCholesky(S, PHT, K, llt, ldlt);
+		}
+		D[j] = d;
+		inv_D[j] = Scalar(1) / d;
+		for (int i = j + 1; i < NZ; ++i) {
+			Scalar v = S(i, j);
+			for (int k = 0; k < j; ++k)
+				v -= L[i][k]*LD[k];
+			L[i][j] = v*inv_D[j];
+		}
+	}
+	// V * L^T = PHT, then U = V * D^-1
+	Eigen::Matrix<Scalar, NX, NZ> V;
+	for (int j = 0; j < NZ; ++j) {
+		Eigen::Matrix<Scalar, NX, 1> v = PHT.col(j);
+		for (int k = 0; k < j; ++k)
+			v -= V.col(k)*L[j][k];
+		V.col(j) = v;
+	}
+	// K * L = U
+	for (int j = NZ - 1; j >= 0; --j) {
+		Eigen::Matrix<Scalar, NX, 1> k_j = V.col(j)*inv_D[j];
+		for (int k = j + 1; k < NZ; ++k)
+			k_j -= K.col(k)*L[k][j];
+		K.col(j) = k_j;
+	}
+	return true;
+}
+
+/**
+ * Dispatches a fixed measurement dimension to its kernel at compile time
+ */
+template <int NZ>
+struct GainSolver {
+	template <typename Scalar, int NX>
+	static bool Run(const Eigen::Matrix<Scalar, NZ, NZ> &S,
+		const Eigen::Matrix<Scalar, NX, NZ> &PHT, Eigen::Matrix<Scalar, NX, NZ> &K) {
+		return SolveGainCholesky(S, PHT, K);
+	}
+};
+
+template <>
+struct GainSolver<2> {
+	template <typename Scalar, int NX>
+	static bool Run(const Eigen::Matrix<Scalar, 2, 2> &S,
+		const Eigen::Matrix<Scalar, NX, 2> &PHT, Eigen::Matrix<Scalar, NX, 2> &K) {
+		return SolveGain2x2(S, PHT, K) || SolveGainCholesky(S, PHT, K);
+	}
+};
+
+template <>
+struct GainSolver<4> {
+	template <typename Scalar, int NX>
+	static bool Run(const Eigen::Matrix<Scalar, 4, 4> &S,
+		const Eigen::Matrix<Scalar, NX, 4> &PHT, Eigen::Matrix<Scalar, NX, 4> &K) {
+		return SolveGain4x4(S, PHT, K) || SolveGainCholesky(S, PHT, K);
+	}
+};
+
+template <>
+struct GainSolver<3> {
+	template <typename Scalar, int NX>
+	static bool Run(const Eigen::Matrix<Scalar, 3, 3> &S,
+		const Eigen::Matrix<Scalar, NX, 3> &PHT, Eigen::Matrix<Scalar, NX, 3> &K) {
+		return SolveGain3x3(S, PHT, K) || SolveGainCholesky(S, PHT, K);
+	}
+};
+
+/**
+ * K = PHT * S^-1 for fixed-size S and PHT
+ */
+template <typename Scalar, int NX, int NZ>
+inline bool SolveGain(const Eigen::Matrix<Scalar, NZ, NZ> &S,
+	const Eigen::Matrix<Scalar, NX, NZ> &PHT, Eigen::Matrix<Scalar, NX, NZ> &K) {
+	return GainSolver<NZ>::Run(S, PHT, K);
+}
+
+/**
+ * K = PHT * S^-1 for dynamic-size S and PHT. K must already have the size of
+ * PHT. llt and ldlt are scratch decompositions for sizes other than 2 and 3;
+ * when null, temporaries are used.
+ */
+inline bool SolveGain(const Eigen::MatrixXd &S, const Eigen::MatrixXd &PHT, Eigen::MatrixXd &K,
+	Eigen::LLT<Eigen::MatrixXd> *llt = 0, Eigen::LDLT<Eigen::MatrixXd> *ldlt = 0) {
+	if (S.rows() == 2 && SolveGain2x2(S, PHT, K))
+		return true;
+	if (S.rows() == 3 && SolveGain3x3(S, PHT, K))
+		return true;
+	if (llt && ldlt)
+		return SolveGainCholesky(S, PHT, K, *llt, *ldlt);
+	Eigen::LLT<Eigen::MatrixXd> tmp_llt;
+	Eigen::LDLT<Eigen::MatrixXd> tmp_ldlt;
+	return SolveGainCholesky(S, PHT, K, tmp_llt, tmp_ldlt);
+}
+
+/**
+ * True when every off-diagonal element of R is exactly zero
+ */
+template <typename DerivedR>
+inline bool IsDiagonal(const Eigen::MatrixBase<DerivedR> &R) {
+	for (int j = 0; j < R.cols(); ++j)
+		for (int i = 0; i < R.rows(); ++i)
+			if (i != j && R(i, j) != 0)
+				return false;
+	return true;
+}
+
+/**
+ * Sequential (scalar) measurement update for a diagonal R.
+ * Equivalent to the joint update x += K*y, P -= K*H*P, but processes one
+ * measurement component at a time; the innovation of each component is
+ * corrected by the state change of the components before it, so nonlinear
+ * (EKF) innovations keep their original linearisation point.
+ * @param x State, updated in place
+ * @param P State covariance, updated in place
+ * @param y Innovation z - h(x)
+ * @param H Measurement matrix or Jacobian
+ * @param r Diagonal of R
+ * @return false if a component had a non-positive innovation variance; that
+ * component is skipped and the others are still applied
+ */
+template <typename DerivedX, typename DerivedP, typename DerivedY, typename DerivedH, typename DerivedR>
+inline bool SequentialUpdate(Eigen::MatrixBase<DerivedX> &x, Eigen::MatrixBase<DerivedP> &P,
+	const Eigen::MatrixBase<DerivedY> &y, const Eigen::MatrixBase<DerivedH> &H,
+	const Eigen::MatrixBase<DerivedR> &r) {
+	typedef typename DerivedP::Scalar Scalar;
+	typedef Eigen::Matrix<Scalar, DerivedP::RowsAtCompileTime, 1, 0,
+		DerivedP::MaxRowsAtCompileTime, 1> Column;
+	bool ok = true;
+	Column dx = Column::Zero(P.rows());
+	Column ph(P.rows());
+	for (int i = 0; i < H.rows(); ++i) {
+		ph.noalias() = P*H.row(i).transpose();
+		const Scalar s = H.row(i).dot(ph) + r(i);
+		if (!(s > 0)) {
+			ok = false;
+			continue;
+		}
+		const Scalar innovation = y(i) - H.row(i).dot(dx);
+		const Scalar inv_s = Scalar(1) / s;
+		dx += ph*(innovation*inv_s);
+		P.noalias() -= (ph*inv_s)*ph.transpose();
+	}
+	x += dx;
+	return ok;
+}
+
+/**
+ * Form of the covariance update once the gain K is known
+ */
+enum CovarianceUpdate {
+	// P -= K*(H*P), the full product
+	STANDARD_UPDATE,
+	// P -= K*S*K^T as a symmetric rank-k update of the upper triangle
+	SYMMETRIC_UPDATE,
+	// P = (I - K*H)*P*(I - K*H)^T + K*R*K^T, positive semi-definite by
+	// construction and first-order insensitive to errors in K
+	JOSEPH_UPDATE
+};
+
+/**
+ * P -= K*S*K^T, computing the upper triangle and mirroring it
+ * @param KS Scratch, resized to the shape of K
+ */
+template <typename DerivedP, typename DerivedK, typename DerivedS, typename DerivedW>
+inline void SymmetricUpdate(Eigen::MatrixBase<DerivedP> &P, const Eigen::MatrixBase<DerivedK> &K,
+	const Eigen::MatrixBase<DerivedS> &S, Eigen::MatrixBase<DerivedW> &KS) {
+	KS.noalias() = K*S;
+	for (int j = 0; j < P.cols(); ++j)
+		for (int i = 0; i <= j; ++i)
+			P(j, i) = P(i, j) -= KS.row(i).dot(K.row(j));
+}
+
+/**
+ * P = (I - K*H)*P*(I - K*H)^T + K*R*K^T, computing the upper triangle and
+ * mirroring it
+ * @param A, AP Scratch of the shape of P
+ * @param KR Scratch of the shape of K
+ */
+template <typename DerivedP, typename DerivedK, typename DerivedH, typename DerivedR,
+	typename DerivedA, typename DerivedW>
+inline void JosephUpdate(Eigen::MatrixBase<DerivedP> &P, const Eigen::MatrixBase<DerivedK> &K,
+	const Eigen::MatrixBase<DerivedH> &H, const Eigen::MatrixBase<DerivedR> &R,
+	Eigen::MatrixBase<DerivedA> &A, Eigen::MatrixBase<DerivedA> &AP, Eigen::MatrixBase<DerivedW> &KR) {
+	A.noalias() = -K*H;
+	A.diagonal().array() += 1;
+	AP.noalias() = A*P;
+	KR.noalias() = K*R;
+	for (int j = 0; j < P.cols(); ++j)
+		for (int i = 0; i <= j; ++i)
+			P(j, i) = P(i, j) = AP.row(i).dot(A.row(j)) + KR.row(i).dot(K.row(j));
+}
+
+/**
+ * Covariance update for fixed sizes, with stack scratch
+ */
+template <typename Scalar, int NX, int NZ>
+inline void UpdateCovariance(Eigen::Matrix<Scalar, NX, NX> &P, const Eigen::Matrix<Scalar, NX, NZ> &K,
+	const Eigen::Matrix<Scalar, NZ, NX> &H, const Eigen::Matrix<Scalar, NZ, NZ> &S,
+	const Eigen::Matrix<Scalar, NZ, NZ> &R, CovarianceUpdate form) {
+	if (form == SYMMETRIC_UPDATE) {
+		Eigen::Matrix<Scalar, NX, NZ> KS;
+		SymmetricUpdate(P, K, S, KS);
+	}
+	else if (form == JOSEPH_UPDATE) {
+		Eigen::Matrix<Scalar, NX, NX> A, AP;
+		Eigen::Matrix<Scalar, NX, NZ> KR;
+		JosephUpdate(P, K, H, R, A, AP, KR);
+	}
+	else {
+		Eigen::Matrix<Scalar, NZ, NX> HP = H*P;
+		P.noalias() -= K*HP;
+	}
+}
+
+} // namespace kf_update
+
+
+#endif //KF_KF_UPDATE_H
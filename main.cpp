@@ -97,7 +97,7 @@ int KFSimulation() {
 
 	check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
-	std::vector<MeasurementPackage> measurement_pack_list;//ֵݰ
+	MeasurementLog measurement_pack_list;//ֵݰ
 	std::vector<GroundTruthPackage> gt_pack_list;//ʵֵ
 
 	std::string line;
@@ -116,7 +116,6 @@ int KFSimulation() {
 	while (getline(in_file_, line)) {
 
 		std::string sensor_type;
-		MeasurementPackage meas_package;
 		GroundTruthPackage gt_package;
 		std::istringstream iss(line);
 		long long timestamp;
@@ -127,14 +126,11 @@ int KFSimulation() {
 			// LASER MEASUREMENT
 
 			// read measurements at this timestamp
-			meas_package.sensor_type_ = MeasurementPackage::LASER;
-			meas_package.raw_measurements_ = Eigen::VectorXd(2);
 			iss >> x;
 			iss >> y;
-			meas_package.raw_measurements_ << x, y;
 			iss >> timestamp;
-			meas_package.timestamp_ = timestamp;
-			measurement_pack_list.push_back(meas_package);
+			const double values[] = { x, y };
+			measurement_pack_list.Append(timestamp, MeasurementPackage::LASER, values, 2);
 
 			// read ground truth data to compare later
 			iss >> x_gt;
@@ -148,8 +144,6 @@ int KFSimulation() {
 		else 
 		if (sensor_type.compare("R") == 0) {
 			// RADAR MEASUREMENT
-			meas_package.sensor_type_ = MeasurementPackage::RADAR;
-			meas_package.raw_measurements_ = Eigen::VectorXd(4);
 			iss >> ro;
 			iss >> phi;
 			iss >> ro_dot;
@@ -159,10 +153,9 @@ int KFSimulation() {
 				phi -= DoublePI;
 			while (phi < -M_PI)
 				phi += DoublePI;
-			meas_package.raw_measurements_ << ro * cos(phi), ro * sin(phi), ro_dot* cos(phi), ro_dot* sin(phi);
+			const double values[] = { ro * cos(phi), ro * sin(phi), ro_dot* cos(phi), ro_dot* sin(phi) };
 			iss >> timestamp;
-			meas_package.timestamp_ = timestamp;
-			measurement_pack_list.push_back(meas_package);
+			measurement_pack_list.Append(timestamp, MeasurementPackage::RADAR, values, 4);
 
 			// read ground truth data to compare later
 			iss >> x_gt;
@@ -267,7 +260,7 @@ int EKFSimulation() {
 
     check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
-	std::vector<MeasurementPackage> measurement_pack_list;//ֵݰ
+	MeasurementLog measurement_pack_list;//ֵݰ
 	std::vector<GroundTruthPackage> gt_pack_list;//ʵֵ
 
 	std::string line;
@@ -286,7 +279,6 @@ int EKFSimulation() {
     while (getline(in_file_, line)) {
 
 		std::string sensor_type;
-        MeasurementPackage meas_package;
         GroundTruthPackage gt_package;
 		std::istringstream iss(line);
         long long timestamp;
@@ -297,14 +289,11 @@ int EKFSimulation() {
             // LASER MEASUREMENT
 
             // read measurements at this timestamp
-            meas_package.sensor_type_ = MeasurementPackage::LASER;
-			meas_package.raw_measurements_ = Eigen::VectorXd(2);
             iss >> x;
             iss >> y;
-            meas_package.raw_measurements_ << x, y;
             iss >> timestamp;
-            meas_package.timestamp_ = timestamp;
-            measurement_pack_list.push_back(meas_package);
+            const double values[] = { x, y };
+            measurement_pack_list.Append(timestamp, MeasurementPackage::LASER, values, 2);
 			// read ground truth data to compare later
 			iss >> x_gt;
 			iss >> y_gt;
@@ -317,15 +306,12 @@ int EKFSimulation() {
     	else 
     	if (sensor_type.compare("R") == 0) {
             // RADAR MEASUREMENT
-			meas_package.sensor_type_ = MeasurementPackage::RADAR;
-			meas_package.raw_measurements_ = Eigen::VectorXd(3);
 			         iss >> ro;
 			         iss >> phi;
 			         iss >> ro_dot;
-			meas_package.raw_measurements_ << ro, phi, ro_dot;
             iss >> timestamp;
-            meas_package.timestamp_ = timestamp;
-            measurement_pack_list.push_back(meas_package);
+			const double values[] = { ro, phi, ro_dot };
+            measurement_pack_list.Append(timestamp, MeasurementPackage::RADAR, values, 3);
 			// read ground truth data to compare later
 			iss >> x_gt;
 			iss >> y_gt;
@@ -429,7 +415,7 @@ int main() {
 
 	check_files(in_file_, in_file_name_, out_file_, out_file_name_);
 
-	std::vector<MeasurementPackage> measurement_pack_list;//ֵݰ
+	MeasurementLog measurement_pack_list;//ֵݰ
 	std::vector<GroundTruthPackage> gt_pack_list;//ʵֵ
 
 	std::string line;
@@ -448,7 +434,6 @@ int main() {
 	while (getline(in_file_, line)) {
 
 		std::string sensor_type;
-		MeasurementPackage meas_package;
 		GroundTruthPackage gt_package;
 		std::istringstream iss(line);
 		double timestamp;
@@ -459,8 +444,6 @@ int main() {
 			// LASER MEASUREMENT
 
 		// read measurements at this timestamp
-		meas_package.sensor_type_ = MeasurementPackage::LASER;
-		meas_package.raw_measurements_ = Eigen::VectorXd(2);
 
 		//iss >> x;
 		//iss >> x;
@@ -468,11 +451,10 @@ int main() {
 
 		iss >> x;
 		iss >> y;
-		meas_package.raw_measurements_ << x , y;
 		iss >> timestamp;
 		iss >> timestamp;
-		meas_package.timestamp_ = timestamp;
-		measurement_pack_list.push_back(meas_package);
+		const double values[] = { x, y };
+		measurement_pack_list.Append(timestamp, MeasurementPackage::LASER, values, 2);
 			// read ground truth data to compare later
 			//iss >> x_gt;
 			//iss >> y_gt;
@@ -2,7 +2,11 @@
 #define MEASUREMENT_PACKAGE_H_
 
 #include "Eigen/Dense"
+#include <vector>
 const double DoublePI = 2 * M_PI;
+
+class MeasurementView;
+
 class MeasurementPackage {
 public:
   double timestamp_;
@@ -15,6 +19,90 @@ public:
 
   Eigen::VectorXd raw_measurements_;
   MeasurementPackage(){};
+
+  /**
+   * Copies a view into this package; raw_measurements_ is only
+   * reallocated when its size changes
+   */
+  void Assign(const MeasurementView &meas);
+};
+
+/**
+ * A measurement that does not own its values: the timestamp, the sensor
+ * and a map over raw values kept elsewhere (a MeasurementPackage, a
+ * MeasurementLog, a parser's buffer), which must outlive the view. The
+ * members have the names and the roles of MeasurementPackage's, so code
+ * reading a package reads a view unchanged.
+ *
+ * Every filter's ProcessMeasurement takes a view; a MeasurementPackage
+ * converts to one implicitly, without copying its values.
+ */
+class MeasurementView {
+public:
+  double timestamp_;
+  MeasurementPackage::SensorType sensor_type_;
+  Eigen::Map<const Eigen::VectorXd> raw_measurements_;
+
+  MeasurementView(double timestamp, MeasurementPackage::SensorType sensor, const double *values, int size)
+    : timestamp_(timestamp), sensor_type_(sensor), raw_measurements_(values, size) {}
+
+  MeasurementView(const MeasurementPackage &meas)
+    : timestamp_(meas.timestamp_), sensor_type_(meas.sensor_type_),
+      raw_measurements_(meas.raw_measurements_.data(), meas.raw_measurements_.size()) {}
+
+private:
+  // a Map assigns the values it points to, not the pointer
+  MeasurementView &operator=(const MeasurementView &);
+};
+
+inline void MeasurementPackage::Assign(const MeasurementView &meas) {
+  timestamp_ = meas.timestamp_;
+  sensor_type_ = meas.sensor_type_;
+  raw_measurements_ = meas.raw_measurements_;
+}
+
+/**
+ * A whole recording in two flat arrays, the raw values of every
+ * measurement back to back and one record per measurement, so that a
+ * parser can append a log and the filters read it through views without
+ * an allocation per measurement (the arrays grow geometrically).
+ * Views stay valid until the next Append().
+ */
+class MeasurementLog {
+public:
+  void Reserve(size_t measurements, size_t values) {
+    records_.reserve(measurements);
+    values_.reserve(values);
+  }
+
+  void Append(double timestamp, MeasurementPackage::SensorType sensor, const double *values, int size) {
+    Record record = { timestamp, sensor, values_.size(), size };
+    records_.push_back(record);
+    values_.insert(values_.end(), values, values + size);
+  }
+
+  void Clear() {
+    records_.clear();
+    values_.clear();
+  }
+
+  size_t size() const { return records_.size(); }
+
+  MeasurementView operator[](size_t i) const {
+    const Record &record = records_[i];
+    return MeasurementView(record.timestamp, record.sensor, values_.data() + record.offset, record.size);
+  }
+
+private:
+  struct Record {
+    double timestamp;
+    MeasurementPackage::SensorType sensor;
+    size_t offset;
+    int size;
+  };
+
+  std::vector<Record> records_;
+  std::vector<double> values_;
 };
 
 #endif /* MEASUREMENT_PACKAGE_H_ */
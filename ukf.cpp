@@ -13,19 +13,13 @@ using std::vector;
 /**
  * Initializes Unscented Kalman filter
  */
-UKF::UKF() {
+UKF::UKF() : sigma_points_(SigmaPoints::Julier(3 - NAUG)) {
     // if this is false, laser measurements will be ignored (except during init)
     use_laser_ = true;
 
     // if this is false, radar measurements will be ignored (except during init)
     use_radar_ = true;
 
-    // initial state vector
-    x_ = VectorXd(5);
-
-    // initial covariance matrix
-    P_ = MatrixXd(5, 5);
-
     // Process noise standard deviation longitudinal acceleration in m/s^2
     std_a_ = 2.0;
 
@@ -60,32 +54,46 @@ UKF::UKF() {
             0, 0, 0, 1, 0,
             0, 0, 0, 0, 1;
     x_.fill(0.0);
-    Xsig_pred_ = MatrixXd(n_x_, 2 * n_aug_ + 1);
 
-    weights_ = VectorXd(2 * n_aug_ + 1);
-    weights_[0] = lambda_/ (lambda_ + n_aug_);
-    for(int i=1; i < (2*n_aug_+1); i++){
-        weights_[i] = 1/(2 * (lambda_ + n_aug_));
-    }
+    setSigmaPoints(SigmaPoints::Julier(lambda_));
 
-    R_laser_ = MatrixXd(2, 2);
     R_laser_ << std_laspx_*std_laspx_, 0,
             0, std_laspy_*std_laspy_;
 
-    R_radar_ = MatrixXd(3, 3);
     R_radar_ << std_radr_*std_radr_, 0, 0,
             0, std_radphi_*std_radphi_, 0,
             0, 0, std_radrd_*std_radrd_;
 
+    square_root_ = false;
+    sqrt_P_ = P_;
+    linear_[MeasurementPackage::LASER] = true;
+    linear_[MeasurementPackage::LASER_RADAR] = false;
+    linear_[MeasurementPackage::RADAR] = false;
+    llt_failures_ = 0;
+    downdate_failures_ = 0;
+}
+
+void UKF::setSigmaPoints(const SigmaPoints &set) {
+    sigma_points_ = set;
+    weights_ = set.weights();
+    Xsig_pred_.setZero(NX, set.size());
+}
+
+void UKF::setSquareRoot(bool on) {
+    square_root_ = on;
+    if (on) {
+        const Eigen::LLT<StateMatrix> llt(P_);
+        sqrt_P_ = llt.matrixL();
+    }
 }
 
 UKF::~UKF() {}
 
 /**
- * @param {MeasurementPackage} meas_package The latest measurement data of
+ * @param {MeasurementView} meas_package The latest measurement data of
  * either radar or laser.
  */
-void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
+void UKF::ProcessMeasurement(const MeasurementView &meas_package) {
     /**
     TODO:
 
@@ -115,8 +123,18 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
         }
         time_us_ = meas_package.timestamp_;
         is_initialized_ = true;
+        oosm_.Record(meas_package, x_, P_);
         return;
     }
+    if (oosm_.enabled() && meas_package.timestamp_ < double(time_us_)) {
+        ProcessLate(meas_package);
+        return;
+    }
+    Step(meas_package);
+    oosm_.Record(meas_package, x_, P_);
+}
+
+void UKF::Step(const MeasurementView &meas_package) {
     double delta_t =(meas_package.timestamp_ - time_us_) /  1000000.0;
     time_us_ = meas_package.timestamp_;
     Prediction(delta_t);
@@ -128,6 +146,64 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
     }
 }
 
+void UKF::ProcessLate(const MeasurementView &meas_package) {
+    History::Plan plan;
+    if (!oosm_.Prepare(meas_package.timestamp_, plan))
+        return;
+    if (!plan.replay) {
+        Retrodict(meas_package);
+        if (oosm_.Insert(meas_package, plan) >= 0)
+            oosm_.Store(oosm_.size() - 1, x_, P_);
+        return;
+    }
+    // rewind to the last snapshot before the measurement and process
+    // everything after it again in order
+    const History::Entry &start = oosm_.at(plan.from);
+    x_ = start.x;
+    P_ = start.P;
+    if (square_root_)
+        setSquareRoot(true);
+    time_us_ = start.timestamp;
+    oosm_.Insert(meas_package, plan);
+    for (int i = plan.from + 1; i < oosm_.size(); ++i) {
+        Step(oosm_.at(i).meas);
+        oosm_.Store(i, x_, P_);
+    }
+}
+
+/**
+ * Unscented retrodiction: the augmented sigma points of the current state
+ * are run back to the measurement time (dt < 0), the predicted measurement
+ * and S come from them, and the cross covariance is taken against the
+ * current-time points, so the update lands on the current state. The
+ * noise columns carry the process noise over the lag into S.
+ */
+void UKF::Retrodict(const MeasurementView &meas_package) {
+    double delta_t = (meas_package.timestamp_ - time_us_) / 1000000.0;
+    AugmentedSigmaMatrix Xsig_aug;
+    AugmentedSigmaPoints(&Xsig_aug);
+    SigmaPointPrediction(Xsig_aug, delta_t);
+
+    if (meas_package.sensor_type_ == MeasurementPackage::RADAR) {
+        const Eigen::Vector3d z = meas_package.raw_measurements_.head<3>();
+        Eigen::Vector3d z_pred;
+        Eigen::Matrix3d S_out;
+        RadarSigmaMatrix Zsig;
+        PredictRadarMeasurement(z_pred, S_out, Zsig);
+        // current-time sigma points; their weighted mean is x_
+        Xsig_pred_ = Xsig_aug.topRows<NX>();
+        UpdateState(z, z_pred, S_out, Zsig);
+    } else {
+        const Eigen::Vector2d z = meas_package.raw_measurements_.head<2>();
+        Eigen::Vector2d z_pred;
+        Eigen::Matrix2d S_out;
+        LidarSigmaMatrix Zsig;
+        PredictLaserMeasurement(z_pred, S_out, Zsig);
+        Xsig_pred_ = Xsig_aug.topRows<NX>();
+        UpdateState(z, z_pred, S_out, Zsig);
+    }
+}
+
 /**
  * Predicts sigma points, the state, and the state covariance matrix.
  * @param {double} delta_t the change in time (in seconds) between the last
@@ -135,8 +211,7 @@ void UKF::ProcessMeasurement(MeasurementPackage meas_package) {
  */
 void UKF::Prediction(double delta_t) {
 
-    MatrixXd Xsig_aug = MatrixXd(n_aug_, 2 * n_aug_ + 1);
-    Xsig_aug.fill(0.0);
+    AugmentedSigmaMatrix Xsig_aug;
     AugmentedSigmaPoints(&Xsig_aug);
     SigmaPointPrediction(Xsig_aug, delta_t);
     PredictMeanAndCovariance();
@@ -144,162 +219,226 @@ void UKF::Prediction(double delta_t) {
 
 /**
  * Updates the state and the state covariance matrix using a laser measurement.
- * @param {MeasurementPackage} meas_package
+ * @param {MeasurementView} meas_package
  */
-void UKF::UpdateLidar(MeasurementPackage meas_package) {
+void UKF::UpdateLidar(const MeasurementView &meas_package) {
 
-    VectorXd z = meas_package.raw_measurements_;
-    long n_z = z.rows();
+    const Eigen::Vector2d z = meas_package.raw_measurements_.head<2>();
+    if (linear_[MeasurementPackage::LASER]) {
+        UpdateLinearLidar(z);
+        return;
+    }
 
-    VectorXd z_pred = VectorXd(n_z);
-    MatrixXd S_out = MatrixXd(n_z, n_z);
-    MatrixXd Zsig = MatrixXd(n_z, 2 * n_aug_ + 1);
+    Eigen::Vector2d z_pred;
+    Eigen::Matrix2d S_out;
+    LidarSigmaMatrix Zsig;
 
-    PredictLaserMeasurement(z_pred, S_out, Zsig, n_z);
+    PredictLaserMeasurement(z_pred, S_out, Zsig);
 
-    UpdateState(z, z_pred, S_out, Zsig, n_z);
+    UpdateState(z, z_pred, S_out, Zsig);
 }
 
 /**
- * Updates the state and the state covariance matrix using a radar measurement.
- * @param {MeasurementPackage} meas_package
+ * Lidar sees px and py, H = [I2 0]: the sigma point mean and covariance of
+ * the predicted measurement and the cross covariance are then exactly
+ * x_.head(2), the top-left block of P_ plus R and the first two columns of
+ * P_, so the update is the Kalman update without the sigma points.
  */
-void UKF::UpdateRadar(MeasurementPackage meas_package) {
-
-
-    VectorXd z = meas_package.raw_measurements_;
-    long n_z = z.rows();
-
-    VectorXd z_pred = VectorXd(n_z);
-    MatrixXd S_out = MatrixXd(n_z, n_z);
-    MatrixXd Zsig = MatrixXd(n_z, 2 * n_aug_ + 1);
-
-    PredictRadarMeasurement(z_pred, S_out, Zsig, n_z);
+void UKF::UpdateLinearLidar(const Eigen::Vector2d &z) {
+    Eigen::Matrix2d S;
+    if (square_root_) {
+        // factor of H*P*H^T + R from the top rows of the factor of P and chol(R)
+        const Eigen::LLT<Eigen::Matrix2d> llt(R_laser_);
+        Eigen::Matrix<double, 2, NX + 2> C;
+        C.leftCols<NX>() = sqrt_P_.topRows<2>();
+        C.rightCols<2>() = llt.matrixL();
+        kf_cholesky::TriangularFactor(C, S);
+    } else {
+        S = P_.topLeftCorner<2, 2>() + R_laser_;
+    }
+    const Eigen::Matrix<double, NX, 2> Tc = P_.leftCols<2>();
+    ApplyUpdate(Eigen::Vector2d(z - x_.head<2>()), S, Tc);
+}
 
-    UpdateState(z, z_pred, S_out, Zsig, n_z);
+bool UKF::setLinearUpdate(MeasurementPackage::SensorType sensor, bool on) {
+    if (sensor != MeasurementPackage::LASER)
+        return false;
+    linear_[sensor] = on;
+    return true;
 }
 
-void UKF::AugmentedSigmaPoints(MatrixXd *Xsig_out) {
+/**
+ * Updates the state and the state covariance matrix using a radar measurement.
+ * @param {MeasurementView} meas_package
+ */
+void UKF::UpdateRadar(const MeasurementView &meas_package) {
 
-    //create augmented mean vector
-    VectorXd x_aug = VectorXd(7);
+    const Eigen::Vector3d z = meas_package.raw_measurements_.head<3>();
 
-    //create augmented state covariance
-    MatrixXd P_aug = MatrixXd(7, 7);
+    Eigen::Vector3d z_pred;
+    Eigen::Matrix3d S_out;
+    RadarSigmaMatrix Zsig;
 
-    //create sigma point matrix
-    MatrixXd Xsig_aug = MatrixXd(n_aug_, 2 * n_aug_ + 1);
+    PredictRadarMeasurement(z_pred, S_out, Zsig);
 
-    //create augmented mean state
-    //create augmented covariance matrix
-    //create square root matrix
-    //create augmented sigma points
-    x_aug.head(5) = x_;
-    x_aug(5) = 0;
-    x_aug(6) = 0;
+    UpdateState(z, z_pred, S_out, Zsig);
+}
 
-    P_aug.fill(0.0);
-    P_aug.topLeftCorner(5, 5) = P_;
-    P_aug(5,5) = std_a_*std_a_;
-    P_aug(6,6) = std_yawdd_*std_yawdd_;
+namespace {
 
-    MatrixXd A = P_aug.llt().matrixL();
+// L*L^T += sigma*v*v^T, leaving L as it was when that fails
+template <int N>
+inline bool TryRankUpdate(Eigen::Matrix<double, N, N> &L, const Eigen::Matrix<double, N, 1> &v, double sigma) {
+    Eigen::Matrix<double, N, N> updated = L;
+    if (!kf_cholesky::RankUpdate(updated, v, sigma))
+        return false;
+    L = updated;
+    return true;
+}
 
-    //create augmented sigma points
-    Xsig_aug.col(0)  = x_aug;
-    for (int i = 0; i< n_aug_; i++)
-    {
-        Xsig_aug.col(i+1)       = x_aug + sqrt(lambda_+n_aug_) * A.col(i);
-        Xsig_aug.col(i+1+n_aug_) = x_aug - sqrt(lambda_+n_aug_) * A.col(i);
+// wraps every entry of a into [-pi, pi]
+template <typename Derived>
+inline void NormalizeAngles(Eigen::DenseBase<Derived> &a) {
+    for (int i = 0; i < a.size(); ++i) {
+        while (a(i) > M_PI) a(i) -= 2. * M_PI;
+        while (a(i) < -M_PI) a(i) += 2. * M_PI;
     }
-
-    //write result
-    *Xsig_out = Xsig_aug;
 }
 
-void UKF::SigmaPointPrediction(MatrixXd &Xsig_aug, double delta_t) {
-
-    for(int i =0; i < (2 * n_aug_ + 1); i++){
-        VectorXd input_x = Xsig_aug.col(i);
-        float px = input_x[0];
-        float py = input_x[1];
-        float v = input_x[2];
-        float psi = input_x[3];
-        float psi_dot = input_x[4];
-        float mu_a = input_x[5];
-        float mu_psi_dot_dot = input_x[6];
-
-        VectorXd term2 = VectorXd(5);
-        VectorXd term3 = VectorXd(5);
-
-        VectorXd result = VectorXd(5);
-        if(psi_dot < 0.001){
-            term2 << v * cos(psi) * delta_t, v * sin(psi) * delta_t, 0, psi_dot * delta_t, 0;
-            term3 << 0.5 * delta_t*delta_t * cos(psi) * mu_a,
-                    0.5 * delta_t*delta_t * sin(psi) * mu_a,
-                    delta_t * mu_a,
-                    0.5 * delta_t*delta_t * mu_psi_dot_dot,
-                    delta_t * mu_psi_dot_dot;
-            result = Xsig_aug.col(i).head(5) + term2 + term3;
-        } else{
-            term2 << (v/psi_dot) * (sin(psi + psi_dot * delta_t) - sin(psi)),
-                    (v/psi_dot) * (-cos(psi + psi_dot * delta_t) + cos(psi)),
-                    0,
-                    psi_dot * delta_t,
-                    0;
-
-            term3 << 0.5 * delta_t*delta_t * cos(psi) * mu_a,
-                    0.5 * delta_t*delta_t * sin(psi) * mu_a,
-                    delta_t * mu_a,
-                    0.5 * delta_t*delta_t * mu_psi_dot_dot,
-                    delta_t * mu_psi_dot_dot;
-            result = Xsig_aug.col(i).head(5) + term2 + term3;
-        }
-
-        Xsig_pred_.col(i) = result;
-    }
 }
 
-void UKF::PredictMeanAndCovariance() {
-    x_.fill(0.0);
-    for(int i=0; i<2*n_aug_+1; i++){
-        x_ = x_+ weights_[i] * Xsig_pred_.col(i);
+/**
+ * P_aug is block diagonal, P_ and the two noise variances, so its factor is
+ * the factor of P_ next to std_a_ and std_yawdd_: only the 5x5 block is
+ * factorised. For the symmetric sets (Julier, cubature) the points are then
+ * written directly: the state rows of the noise columns are x_, and the
+ * noise rows of all the others are zero. Other sets take x_aug + A*u_i.
+ */
+void UKF::AugmentedSigmaPoints(AugmentedSigmaMatrix *Xsig_out) {
+    const SigmaPoints &set = sigma_points_;
+    const int n_sig = set.size();
+
+    StateMatrix A;
+    if (square_root_) {
+        A = sqrt_P_;
+    } else if (!kf_cholesky::Factor(P_, A)) {
+        ++llt_failures_;
     }
 
-    P_.fill(0.0);
-    for(int i=0;  i<2*n_aug_+1; i++){
-        VectorXd x_diff = Xsig_pred_.col(i) - x_;
-        while (x_diff[3]> M_PI)
-            x_diff[3] -= 2.*M_PI;
-        while (x_diff[3] <-M_PI)
-            x_diff[3]+=2.*M_PI;
-        P_ = P_ + weights_[i] * x_diff * x_diff.transpose();
+    AugmentedSigmaMatrix &Xsig_aug = *Xsig_out;
+    Xsig_aug.resize(NAUG, n_sig);
+    if (set.spread() > 0) {
+        const double spread = set.spread();
+        // the axis points start after the centre, if there is one
+        const int first = set.centred() ? 1 : 0;
+        A *= spread;
+        for (int c = 0; c < n_sig; ++c) {
+            for (int r = 0; r < NX; ++r)
+                Xsig_aug(r, c) = x_[r];
+            Xsig_aug(5, c) = 0;
+            Xsig_aug(6, c) = 0;
+        }
+        // A is lower triangular: column i only moves rows i and below
+        for (int i = 0; i < NX; ++i)
+            for (int r = i; r < NX; ++r) {
+                Xsig_aug(r, first + i) += A(r, i);
+                Xsig_aug(r, first + NAUG + i) -= A(r, i);
+            }
+        Xsig_aug(5, first + 5) = spread * std_a_;
+        Xsig_aug(5, first + NAUG + 5) = -spread * std_a_;
+        Xsig_aug(6, first + 6) = spread * std_yawdd_;
+        Xsig_aug(6, first + NAUG + 6) = -spread * std_yawdd_;
+        return;
     }
+    Xsig_aug.topRows<NX>().noalias() = A.triangularView<Eigen::Lower>() * set.unit().topRows<NX>();
+    Xsig_aug.topRows<NX>().colwise() += x_;
+    Xsig_aug.row(5) = std_a_ * set.unit().row(5);
+    Xsig_aug.row(6) = std_yawdd_ * set.unit().row(6);
 }
 
-void UKF::PredictLaserMeasurement(VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z) {
-    for(int i=0; i < 2*n_aug_+1; i++){
-        float px = Xsig_pred_.col(i)[0];
-        float py = Xsig_pred_.col(i)[1];
+/**
+ * The CTRV model, evaluated for all sigma points at once: each state
+ * component is a row of the sigma point matrix, so every term below is an
+ * element-wise operation on a row as wide as the set. Points with a yaw
+ * rate below 0.001 (signed, as before) take the straight-line model; the
+ * turning model is computed for them too and discarded by select().
+ */
+void UKF::SigmaPointPrediction(const AugmentedSigmaMatrix &Xsig_aug, double delta_t) {
+    typedef Eigen::Array<double, 1, Eigen::Dynamic, Eigen::RowMajor, 1, NSIG> Row;
+
+    const Row v = Xsig_aug.row(2).array();
+    const Row psi = Xsig_aug.row(3).array();
+    const Row psi_dot = Xsig_aug.row(4).array();
+    const Row nu_a = Xsig_aug.row(5).array();
+    const Row nu_yawdd = Xsig_aug.row(6).array();
+
+    const Row cos_psi = psi.cos();
+    const Row sin_psi = psi.sin();
+    const Row psi_p = psi + psi_dot * delta_t;
+    const Row v_psi_dot = v / psi_dot;
+    const double half_dt2 = 0.5 * delta_t * delta_t;
+
+    const Row dx_turn = v_psi_dot * (psi_p.sin() - sin_psi);
+    const Row dy_turn = v_psi_dot * (cos_psi - psi_p.cos());
+    const Row dx = (psi_dot < 0.001).select(v * cos_psi * delta_t, dx_turn);
+    const Row dy = (psi_dot < 0.001).select(v * sin_psi * delta_t, dy_turn);
+
+    Xsig_pred_.resize(NX, Xsig_aug.cols());
+    Xsig_pred_.row(0).array() = Xsig_aug.row(0).array() + dx + half_dt2 * cos_psi * nu_a;
+    Xsig_pred_.row(1).array() = Xsig_aug.row(1).array() + dy + half_dt2 * sin_psi * nu_a;
+    Xsig_pred_.row(2).array() = v + delta_t * nu_a;
+    Xsig_pred_.row(3).array() = psi_p + half_dt2 * nu_yawdd;
+    Xsig_pred_.row(4).array() = psi_dot + delta_t * nu_yawdd;
+}
 
-        VectorXd temp = VectorXd(n_z);
-        temp << px, py;
-        Zsig.col(i) = temp;
+void UKF::PredictMeanAndCovariance() {
+    x_.noalias() = Xsig_pred_ * weights_;
+
+    SigmaMatrix x_diff = Xsig_pred_.colwise() - x_;
+    SigmaMatrix::RowXpr yaw = x_diff.row(3);
+    NormalizeAngles(yaw);
+    if (square_root_) {
+        // the points with a positive weight by QR, a negative centre weight
+        // (the Julier set for lambda < 0) as a rank-one update
+        const int first = weights_[0] < 0 ? 1 : 0;
+        const int n = int(x_diff.cols()) - first;
+        const SigmaMatrix C = x_diff.rightCols(n) * weights_.tail(n).cwiseSqrt().asDiagonal();
+        kf_cholesky::TriangularFactor(C, sqrt_P_);
+        if (first && !TryRankUpdate(sqrt_P_, StateVector(x_diff.col(0)), weights_[0]))
+            ++downdate_failures_;
+        P_.noalias() = sqrt_P_ * sqrt_P_.transpose();
+        return;
     }
+    P_.noalias() = x_diff * weights_.asDiagonal() * x_diff.transpose();
+}
 
-    z_pred.fill(0.0);
-    for(int i=0; i < 2*n_aug_+1; i++){
-        z_pred = z_pred + weights_[i] * Zsig.col(i);
-    }
+template <int NZ>
+void UKF::InnovationFactor(const Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG> &z_diff,
+                           const Eigen::Matrix<double, NZ, NZ> &R, Eigen::Matrix<double, NZ, NZ> &S) {
+    const Eigen::LLT<Eigen::Matrix<double, NZ, NZ> > llt(R);
+    const int first = weights_[0] < 0 ? 1 : 0;
+    const int n = int(z_diff.cols()) - first;
+    Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG + NZ> C(NZ, n + NZ);
+    C.leftCols(n) = z_diff.rightCols(n) * weights_.tail(n).cwiseSqrt().asDiagonal();
+    C.template rightCols<NZ>() = llt.matrixL();
+    kf_cholesky::TriangularFactor(C, S);
+    if (first && !TryRankUpdate(S, Eigen::Matrix<double, NZ, 1>(z_diff.col(0)), weights_[0]))
+        ++downdate_failures_;
+}
+
+void UKF::PredictLaserMeasurement(Eigen::Vector2d &z_pred, Eigen::Matrix2d &S,
+                                  LidarSigmaMatrix &Zsig) {
+    Zsig = Xsig_pred_.topRows<2>();
 
-    S.fill(0.0);
-    for(int i=0; i < 2*n_aug_+1; i++){
-        //residual
-        VectorXd z_diff = Zsig.col(i) - z_pred;
+    z_pred.noalias() = Zsig * weights_;
 
-        S = S + weights_[i] * z_diff * z_diff.transpose();
+    const LidarSigmaMatrix z_diff = Zsig.colwise() - z_pred;
+    if (square_root_) {
+        InnovationFactor(z_diff, R_laser_, S);
+        return;
     }
-    S = S + R_laser_;
+    S.noalias() = z_diff * weights_.asDiagonal() * z_diff.transpose();
+    S += R_laser_;
 }
 
 void UKF::getState(Eigen::VectorXd& x)
@@ -314,84 +453,105 @@ void UKF::getState(Eigen::VectorXd& x)
 }
 
 
-void UKF::PredictRadarMeasurement(VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z) {
-    for(int i=0; i < 2*n_aug_+1; i++){
-        float px = Xsig_pred_.col(i)[0];
-        float py = Xsig_pred_.col(i)[1];
-        float v = Xsig_pred_.col(i)[2];
-        float psi = Xsig_pred_.col(i)[3];
-        float psi_dot = Xsig_pred_.col(i)[4];
-
-        float temp = px * px + py * py;
-        float rho = sqrt(temp);
-        float phi = atan2(py, px);
-        float rho_dot;
-        if(fabs(rho) < 0.0001){
-            rho_dot = 0;
-        } else{
-            rho_dot =(px * cos(psi) * v + py * sin(psi) * v)/rho;
-        }
-
-        VectorXd temp1 = VectorXd(3);
-        temp1 << rho, phi, rho_dot;
-        Zsig.col(i) = temp1;
-    }
-
-    z_pred.fill(0.0);
-    for(int i=0; i < 2*n_aug_+1; i++){
-        z_pred = z_pred + weights_[i] * Zsig.col(i);
-    }
-
-    S.fill(0.0);
-    for(int i=0; i < 2*n_aug_+1; i++){
-        //residual
-        VectorXd z_diff = Zsig.col(i) - z_pred;
-
-        //angle normalization
-        while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-        while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
-        S = S + weights_[i] * (Zsig.col(i) - z_pred) * (Zsig.col(i) - z_pred).transpose();
+void UKF::PredictRadarMeasurement(Eigen::Vector3d &z_pred, Eigen::Matrix3d &S,
+                                  RadarSigmaMatrix &Zsig) {
+    typedef Eigen::Array<double, 1, Eigen::Dynamic, Eigen::RowMajor, 1, NSIG> Row;
+    const int n_sig = int(Xsig_pred_.cols());
+
+    const Row px = Xsig_pred_.row(0).array();
+    const Row py = Xsig_pred_.row(1).array();
+    const Row v = Xsig_pred_.row(2).array();
+    const Row psi = Xsig_pred_.row(3).array();
+
+    const Row rho = (px * px + py * py).sqrt();
+    Zsig.resize(3, n_sig);
+    Zsig.row(0).array() = rho;
+    for (int i = 0; i < n_sig; ++i)
+        Zsig(1, i) = atan2(py(i), px(i));
+    Zsig.row(2).array() = (rho < 0.0001).select(Row::Zero(n_sig),
+                                                (px * psi.cos() * v + py * psi.sin() * v) / rho);
+
+    z_pred.noalias() = Zsig * weights_;
+
+    // the bearing residuals are wrapped as in UpdateState, where Tc is
+    // taken: with S on the raw ones a point across the +-pi cut (sets with
+    // far-out points near the origin) leaves P_ indefinite after the update
+    RadarSigmaMatrix z_diff = Zsig.colwise() - z_pred;
+    RadarSigmaMatrix::RowXpr bearing = z_diff.row(1);
+    NormalizeAngles(bearing);
+    if (square_root_) {
+        InnovationFactor(z_diff, R_radar_, S);
+        return;
     }
-    S = S + R_radar_;
+    S.noalias() = z_diff * weights_.asDiagonal() * z_diff.transpose();
+    S += R_radar_;
 }
 
 
-void UKF::UpdateState(VectorXd &z, VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z) {
-
-    //create matrix for cross correlation Tc
-    MatrixXd Tc = MatrixXd(n_x_, n_z);
+template <int NZ>
+void UKF::UpdateState(const Eigen::Matrix<double, NZ, 1> &z, const Eigen::Matrix<double, NZ, 1> &z_pred,
+                      const Eigen::Matrix<double, NZ, NZ> &S,
+                      const Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG> &Zsig) {
+    typedef Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG> MeasurementSigmaMatrix;
 
     //calculate cross correlation matrix
     //calculate Kalman gain K;
     //update state mean and covariance matrix
+    SigmaMatrix x_diff = Xsig_pred_.colwise() - x_;
+    SigmaMatrix::RowXpr yaw = x_diff.row(3);
+    NormalizeAngles(yaw);
 
-    Tc.fill(0.0);
-    for(int i=0; i < 2*n_aug_+1; i++){
-        VectorXd x_diff = Xsig_pred_.col(i) - x_;
-
-        while (x_diff(3)> M_PI) x_diff(3)-=2.*M_PI;
-        while (x_diff(3)<-M_PI) x_diff(3)+=2.*M_PI;
-
-        //residual
-        VectorXd z_diff = Zsig.col(i) - z_pred;
-        if(n_z == 3){
-            //angle normalization
-            while (z_diff(1)> M_PI) z_diff(1)-=2.*M_PI;
-            while (z_diff(1)<-M_PI) z_diff(1)+=2.*M_PI;
-        }
-        Tc = Tc + weights_[i] * x_diff * z_diff.transpose();
+    //residual
+    MeasurementSigmaMatrix z_diff = Zsig.colwise() - z_pred;
+    if (NZ == 3) {
+        //angle normalization
+        typename MeasurementSigmaMatrix::RowXpr bearing = z_diff.row(1);
+        NormalizeAngles(bearing);
     }
 
-    MatrixXd K = MatrixXd(5, 3);
-    K = Tc * S.inverse();
+    //create matrix for cross correlation Tc
+    Eigen::Matrix<double, NX, NZ> Tc;
+    Tc.noalias() = x_diff * weights_.asDiagonal() * z_diff.transpose();
 
-    VectorXd y = z - z_pred;
+    Eigen::Matrix<double, NZ, 1> y = z - z_pred;
     //angle normalization
-    if(n_z == 3){
-        while (y(1)> M_PI) y(1)-=2.*M_PI;
-        while (y(1)<-M_PI) y(1)+=2.*M_PI;
+    if (NZ == 3) {
+        Eigen::Block<Eigen::Matrix<double, NZ, 1>, 1, 1> bearing = y.row(1);
+        NormalizeAngles(bearing);
     }
-    x_ = x_ + K * y;
-    P_ = P_ - K * S * K.transpose();
+    ApplyUpdate(y, S, Tc);
 }
 
+template <int NZ>
+void UKF::ApplyUpdate(const Eigen::Matrix<double, NZ, 1> &y, const Eigen::Matrix<double, NZ, NZ> &S,
+                      const Eigen::Matrix<double, NX, NZ> &Tc) {
+    Eigen::Matrix<double, NX, NZ> K;
+    if (square_root_) {
+        // S is the factor Sz of the innovation covariance:
+        // K = Tc*Sz^-T*Sz^-1, and P - K*Sz*Sz^T*K^T is one rank-one
+        // downdate per column of K*Sz
+        if (!(S.diagonal().minCoeff() > 0))
+            return;
+        Eigen::Matrix<double, NZ, NX> Kt = S.template triangularView<Eigen::Lower>().solve(Tc.transpose());
+        S.transpose().template triangularView<Eigen::Upper>().solveInPlace(Kt);
+        K = Kt.transpose();
+        const Eigen::Matrix<double, NX, NZ> U = K * S.template triangularView<Eigen::Lower>();
+        StateMatrix L = sqrt_P_;
+        for (int j = 0; j < NZ; ++j) {
+            if (!kf_cholesky::RankUpdate(L, StateVector(U.col(j)), -1.0)) {
+                ++downdate_failures_;
+                return;
+            }
+        }
+        sqrt_P_ = L;
+        P_.noalias() = sqrt_P_ * sqrt_P_.transpose();
+        x_ += K * y;
+        return;
+    }
+
+    if (!kf_update::SolveGain(S, Tc, K))
+        return;
+    x_ += K * y;
+    Eigen::Matrix<double, NX, NZ> KS;
+    kf_update::SymmetricUpdate(P_, K, S, KS);
+}
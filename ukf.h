@@ -8,6 +8,10 @@
 
 #include "measurement_package.h"
 #include "Eigen/Dense"
+#include "kf_update.h"
+#include "kf_cholesky.h"
+#include "kf_sigma_points.h"
+#include "kf_oosm.h"
 #include <vector>
 #include <string>
 #include <fstream>
@@ -17,6 +21,18 @@ using Eigen::VectorXd;
 
 class UKF {
 public:
+    ///* state and augmented state sizes, and the most sigma points of any set
+    enum { NX = 5, NAUG = 7, NSIG = 2 * NAUG + 1 };
+
+    typedef SigmaPointSet<NAUG> SigmaPoints;
+    typedef Eigen::Matrix<double, NX, 1> StateVector;
+    typedef Eigen::Matrix<double, NX, NX> StateMatrix;
+    // one column per sigma point of the set in use, on the stack
+    typedef Eigen::Matrix<double, NAUG, Eigen::Dynamic, 0, NAUG, NSIG> AugmentedSigmaMatrix;
+    typedef Eigen::Matrix<double, NX, Eigen::Dynamic, 0, NX, NSIG> SigmaMatrix;
+    typedef Eigen::Matrix<double, 2, Eigen::Dynamic, 0, 2, NSIG> LidarSigmaMatrix;
+    typedef Eigen::Matrix<double, 3, Eigen::Dynamic, 0, 3, NSIG> RadarSigmaMatrix;
+    typedef SigmaPoints::WeightVector WeightVector;
 
     ///* initially set to false, set to true in first call of ProcessMeasurement
     bool is_initialized_;
@@ -28,19 +44,17 @@ public:
     bool use_radar_;
 
     ///* state vector: [pos1 pos2 vel_abs yaw_angle yaw_rate] in SI units and rad
-    VectorXd x_;
+    StateVector x_;
 
     ///* state covariance matrix
-    MatrixXd P_;
+    StateMatrix P_;
 
     ///* predicted sigma points matrix
-    MatrixXd Xsig_pred_;
+    SigmaMatrix Xsig_pred_;
 
-    MatrixXd H_laser_;
+    Eigen::Matrix2d R_laser_;
 
-    MatrixXd R_laser_;
-
-    MatrixXd R_radar_;
+    Eigen::Matrix3d R_radar_;
 
     ///* time when the state is true, in us
     long long time_us_;
@@ -66,8 +80,8 @@ public:
     ///* Radar measurement noise standard deviation radius change in m/s
     double std_radrd_;
 
-    ///* Weights of sigma points
-    VectorXd weights_;
+    ///* Weights of sigma points, those of the set in use
+    WeightVector weights_;
 
     ///* State dimension
     int n_x_;
@@ -75,7 +89,7 @@ public:
     ///* Augmented state dimension
     int n_aug_;
 
-    ///* Sigma point spreading parameter
+    ///* Sigma point spreading parameter of the default (Julier) set
     double lambda_;
 
 
@@ -93,7 +107,7 @@ public:
      * ProcessMeasurement
      * @param meas_package The latest measurement data of either radar or laser
      */
-    void ProcessMeasurement(MeasurementPackage meas_package);
+    void ProcessMeasurement(const MeasurementView &meas_package);
 
     /**
      * Prediction Predicts sigma points, the state, and the state covariance
@@ -106,26 +120,125 @@ public:
      * Updates the state and the state covariance matrix using a laser measurement
      * @param meas_package The measurement at k+1
      */
-    void UpdateLidar(MeasurementPackage meas_package);
+    void UpdateLidar(const MeasurementView &meas_package);
 
     /**
      * Updates the state and the state covariance matrix using a radar measurement
      * @param meas_package The measurement at k+1
      */
-    void UpdateRadar(MeasurementPackage meas_package);
+    void UpdateRadar(const MeasurementView &meas_package);
 
-    void AugmentedSigmaPoints(MatrixXd *Xsig_out);
+    void AugmentedSigmaPoints(AugmentedSigmaMatrix *Xsig_out);
 
-    void SigmaPointPrediction(MatrixXd &Xsig_aug, double delta_t);
+    /**
+     * Runs the CTRV model over every column of Xsig_aug at once, one row
+     * of the state at a time, into Xsig_pred_
+     */
+    void SigmaPointPrediction(const AugmentedSigmaMatrix &Xsig_aug, double delta_t);
 
     void PredictMeanAndCovariance();
 
-    void PredictRadarMeasurement(VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z);
+    /**
+     * In square-root mode S receives the lower Cholesky factor of the
+     * innovation covariance rather than the covariance itself, and
+     * UpdateState takes it as such
+     */
+    void PredictRadarMeasurement(Eigen::Vector3d &z_pred, Eigen::Matrix3d &S, RadarSigmaMatrix &Zsig);
 
-    void UpdateState(VectorXd &z, VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z);
+    template <int NZ>
+    void UpdateState(const Eigen::Matrix<double, NZ, 1> &z, const Eigen::Matrix<double, NZ, 1> &z_pred,
+                     const Eigen::Matrix<double, NZ, NZ> &S,
+                     const Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG> &Zsig);
 
-    void PredictLaserMeasurement(VectorXd &z_pred, MatrixXd &S, MatrixXd &Zsig, long n_z);
+    void PredictLaserMeasurement(Eigen::Vector2d &z_pred, Eigen::Matrix2d &S, LidarSigmaMatrix &Zsig);
 	void getState(Eigen::VectorXd& x);
+
+    typedef OosmHistory<StateVector, StateMatrix> History;
+
+    /**
+     * Out-of-sequence measurement handling (see OosmHistory); off until
+     * given a depth with oosm().setDepth()
+     */
+    History &oosm() { return oosm_; }
+
+    /**
+     * Selects the sigma point set (see SigmaPointSet): the Julier set with
+     * lambda_ by default, or SigmaPoints::Simplex() (9 points) or
+     * SigmaPoints::Cubature() (14 points), whose predictions cost about
+     * in proportion to their size. Sets the weights_ to those of the set.
+     * The square-root mode needs every weight but the first non-negative.
+     */
+    void setSigmaPoints(const SigmaPoints &set);
+    const SigmaPoints &sigmaPoints() const { return sigma_points_; }
+
+    /**
+     * Square-root mode: carry the Cholesky factor of P_ from step to step
+     * instead of factorising P_aug for every prediction. The factor is
+     * rebuilt by QR from the weighted sigma point deviations and corrected
+     * by rank-one updates for the centre point and the measurement update
+     * (see kf_cholesky.h). P_ is kept equal to the factor times its
+     * transpose; after changing P_ directly, call setSquareRoot(true) again.
+     */
+    void setSquareRoot(bool on);
+    bool squareRoot() const { return square_root_; }
+
+    ///* predictions whose P_ was not positive definite (standard mode)
+    long lltFailures() const { return llt_failures_; }
+    ///* rank-one downdates that would have lost positive definiteness
+    ///* (square-root mode); the centre point term is then left out, or the
+    ///* update skipped
+    long downdateFailures() const { return downdate_failures_; }
+
+    /**
+     * Declares the measurement model of a sensor linear in the state, so
+     * that its updates skip the sigma points and apply the Kalman update on
+     * x_ and P_ directly. Only LASER (H = [I2 0]) has a linear model here;
+     * for the other sensors this returns false and changes nothing. On for
+     * LASER by default. Late measurements (oosm()) that are retrodicted
+     * always go through the sigma points, which carry the process noise
+     * over the lag.
+     */
+    bool setLinearUpdate(MeasurementPackage::SensorType sensor, bool on);
+    bool linearUpdate(MeasurementPackage::SensorType sensor) const { return linear_[sensor]; }
+
+private:
+    // recent posteriors, for late measurements
+    History oosm_;
+
+    SigmaPoints sigma_points_;
+
+    bool square_root_;
+    // lower Cholesky factor of P_, in square-root mode
+    StateMatrix sqrt_P_;
+    long llt_failures_;
+    long downdate_failures_;
+    // per SensorType: update with the linear model
+    bool linear_[3];
+
+    void UpdateLinearLidar(const Eigen::Vector2d &z);
+
+    // gain, state and covariance update from the innovation, its
+    // covariance S (its factor in square-root mode) and the cross covariance
+    template <int NZ>
+    void ApplyUpdate(const Eigen::Matrix<double, NZ, 1> &y, const Eigen::Matrix<double, NZ, NZ> &S,
+                     const Eigen::Matrix<double, NX, NZ> &Tc);
+
+    // lower Cholesky factor of the innovation covariance from the
+    // measurement sigma point deviations and R
+    template <int NZ>
+    void InnovationFactor(const Eigen::Matrix<double, NZ, Eigen::Dynamic, 0, NZ, NSIG> &z_diff,
+                          const Eigen::Matrix<double, NZ, NZ> &R, Eigen::Matrix<double, NZ, NZ> &S);
+
+    // predict to meas_package and update with it
+    void Step(const MeasurementView &meas_package);
+    // a measurement older than the current state
+    void ProcessLate(const MeasurementView &meas_package);
+    // update the current state with a late measurement, through the sigma
+    // points run back to its timestamp
+    void Retrodict(const MeasurementView &meas_package);
+
+public:
+    EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 };
 
 